@@ -0,0 +1,817 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Interrupt entry/exit latency benchmark.
+ *
+ * For every interrupt class main() stamps mcycle right before the store that
+ * triggers the interrupt, the handler stamps its first and last statement
+ * (CLIC_BENCH_ENTRY/CLIC_BENCH_EXIT) and main() stamps again once it has
+ * been resumed.  From those we report, per class:
+ *
+ *   entry      trigger store -> first handler statement (includes prologue)
+ *   exit       last handler statement -> main resumed (epilogue + mret)
+ *   roundtrip  trigger store -> main resumed
+ *
+ * main() waits for clic_bench_seq to move before taking the resume stamp,
+ * since the trap may be taken a few instructions after the trigger store.
+ * "exit" therefore includes at most one iteration of that wait loop.
+ *
+ * The clic_software_direct class runs the same body through a CLIC direct
+ * mode trap handler that dispatches on mcause, to put a number on the
+ * vectored vs direct claim in example-clic-baremetal.c.
+ *
+ * The burst classes pend the local external lines 16-47 together and time
+ * how long it takes to drain them, once through per-line vectored
+ * preemptible handlers and once through the mnxti dispatcher
+ * (clic_nxti.c), which saves and restores the context once per burst.
+ * The lines are pended by software through clicintip.
+ *
+ * The clic_software_preemptible/fast/naked classes run one body (stamp,
+ * clear clicintip, stamp) in each handler class of clic_naked.h through
+ * a private vector table.  The *_saved rows are the median cycles each
+ * lighter class saves against the preemptible prologue and epilogue.
+ *
+ * The mbox class times a ping/pong round trip through the inter-hart
+ * mailbox (clic_mbox.c) and the cost of a send with and without doorbell.
+ *
+ * With CLIC_STATS=1 the stats class times the per-interrupt statistics
+ * hooks (clic_stats.h).  With CLIC_HIST=1 a second CSV table follows with
+ * the latency/duration percentiles of a software pended local external
+ * line (clic_hist.h).
+ *
+ * The timer_wheel classes time start/cancel/expire of the software timer
+ * wheel (clic_timer.c) as the number of pending timers grows.
+ *
+ * The crit class puts an empty critical section on mstatus.MIE next to
+ * one on mintthresh (clic_crit.h).  With CLIC_CRIT_STATS=1 a last CSV
+ * table lists the longest masked window per ceiling over the whole run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_bench.h"
+#include "clic_nxti.h"
+#include "clic_timer.h"
+#include "clic_mbox.h"
+#include "clic_naked.h"
+#include "clic_stats.h"
+#include "clic_poll.h"
+#include "clic_crit.h"
+
+#if CLIC_BENCHMARK
+
+volatile uint32_t clic_bench_entry_stamp;
+volatile uint32_t clic_bench_exit_stamp;
+volatile uint32_t clic_bench_seq;
+
+static uint32_t entry[CLIC_BENCH_SAMPLES];
+static uint32_t exit_[CLIC_BENCH_SAMPLES];
+static uint32_t roundtrip[CLIC_BENCH_SAMPLES];
+
+/* Private vector table, so the bench does not depend on CLIC_IRQ_MAP */
+static uintptr_t __attribute__((aligned(64))) bench_mtvt[CLIC_VECTOR_TABLE_SIZE_MAX];
+
+/* Wait for the handler to finish and keep the three deltas of sample i */
+static inline __attribute__((always_inline)) void record(unsigned i, uint32_t seq, uint32_t trigger) {
+
+    uint32_t resume;
+
+    while (clic_bench_seq == seq);
+    resume = (uint32_t)read_csr(mcycle);
+
+    entry[i] = clic_bench_entry_stamp - trigger;
+    exit_[i] = resume - clic_bench_exit_stamp;
+    roundtrip[i] = resume - trigger;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void report_n(const char *class, const char *metric, uint32_t *s, unsigned n) {
+
+    qsort(s, n, sizeof(s[0]), cmp_u32);
+    printf("%s,%s,%u,%u,%u,%u,%u\n", class, metric, n,
+           (unsigned)s[0], (unsigned)s[n / 2], (unsigned)s[(n * 99 + 99) / 100 - 1],
+           (unsigned)s[n - 1]);
+}
+
+static void report(const char *class, const char *metric, uint32_t *s) {
+
+    report_n(class, metric, s, CLIC_BENCH_SAMPLES);
+}
+
+static void report_class(const char *class) {
+
+    report(class, "entry", entry);
+    report(class, "exit", exit_);
+    report(class, "roundtrip", roundtrip);
+}
+
+/* CLIC Software Interrupt ID #12, vectored through CLIC_IRQ_MAP */
+static void bench_clic_software(void) {
+
+    uint32_t seq, trigger;
+    uint8_t ctl, ie;
+    unsigned i;
+
+    /* #12 also runs deferred work, put its setup back afterwards */
+    ctl = read_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE));
+    ie = read_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE));
+    write_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), 255);
+    CLIC_SOFTWARE_INT_ENABLE;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        seq = clic_bench_seq;
+        trigger = (uint32_t)read_csr(mcycle);
+        CLIC_SOFTWARE_INT_SET;
+        record(i, seq, trigger);
+    }
+
+    write_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), ie);
+    write_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), ctl);
+    report_class("clic_software");
+}
+
+/* Same body as clic_software_handler, reached through a direct mode trap */
+static void bench_direct_clic_software (void) {
+
+    CLIC_BENCH_ENTRY();
+    CLIC_SOFTWARE_INT_CLEAR;
+    CLIC_BENCH_EXIT();
+}
+
+static void (* const bench_direct_table[MAX_LOCAL_INTS])(void) = {
+    [INT_ID_CLIC_SOFTWARE] = bench_direct_clic_software,
+};
+
+static void __attribute__((CLIC_PREEMPTIBLE, aligned(64))) bench_direct_trap (void) {
+
+    uintptr_t code = MCAUSE_CODE(read_csr(mcause));
+
+    if (code < MAX_LOCAL_INTS && bench_direct_table[code])
+        bench_direct_table[code]();
+}
+
+static void bench_clic_software_direct(void) {
+
+    uintptr_t mtvec = read_csr(mtvec);
+    uint32_t seq, trigger;
+    uint8_t ctl, ie;
+    unsigned i;
+
+    write_csr(mtvec, ((uintptr_t)&bench_direct_trap | MTVEC_MODE_CLIC_DIRECT));
+    ctl = read_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE));
+    ie = read_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE));
+    write_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), 255);
+    CLIC_SOFTWARE_INT_ENABLE;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        seq = clic_bench_seq;
+        trigger = (uint32_t)read_csr(mcycle);
+        CLIC_SOFTWARE_INT_SET;
+        record(i, seq, trigger);
+    }
+
+    write_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), ie);
+    write_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), ctl);
+    write_csr(mtvec, mtvec);
+    report_class("clic_software_direct");
+}
+
+/* The clic_software body in each handler class */
+static void __attribute__((CLIC_PREEMPTIBLE)) bench_preemptible_clic_software (void) {
+
+    CLIC_BENCH_ENTRY();
+    CLIC_SOFTWARE_INT_CLEAR;
+    CLIC_BENCH_EXIT();
+}
+
+static void __attribute__((CLIC_FAST)) bench_fast_clic_software (void) {
+
+    CLIC_BENCH_ENTRY();
+    CLIC_SOFTWARE_INT_CLEAR;
+    CLIC_BENCH_EXIT();
+}
+
+CLIC_NAKED_HANDLER(bench_naked_clic_software,
+                   CLIC_NAKED_STAMP(clic_bench_entry_stamp)
+                   CLIC_NAKED_CLEAR_IP(INT_ID_CLIC_SOFTWARE)
+                   CLIC_NAKED_STAMP(clic_bench_exit_stamp)
+                   CLIC_NAKED_INC(clic_bench_seq),
+                   CLIC_BENCH_ENTRY(); CLIC_SOFTWARE_INT_CLEAR; CLIC_BENCH_EXIT());
+
+/* #12 vectored to handler through bench_mtvt, medians of the three
+ * deltas returned in median[] */
+static void bench_handler_class(const char *class, void (*handler)(void), uint32_t median[3]) {
+
+    uintptr_t old_mtvt = read_csr(0x307);
+    uint32_t seq, trigger;
+    uint8_t ctl, ie;
+    unsigned i, id;
+
+    interrupt_global_disable();
+    for (id = 0; id < CLIC_VECTOR_TABLE_SIZE_MAX; id++)
+        bench_mtvt[id] = ((const uintptr_t *)old_mtvt)[id];
+    bench_mtvt[INT_ID_CLIC_SOFTWARE] = (uintptr_t)handler;
+    fence_i();
+    write_csr(0x307, (uintptr_t)&bench_mtvt);
+    ctl = read_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE));
+    ie = read_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE));
+    write_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), 255);
+    CLIC_SOFTWARE_INT_ENABLE;
+    interrupt_global_enable();
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        seq = clic_bench_seq;
+        trigger = (uint32_t)read_csr(mcycle);
+        CLIC_SOFTWARE_INT_SET;
+        record(i, seq, trigger);
+    }
+
+    interrupt_global_disable();
+    write_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), ie);
+    write_byte(CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), ctl);
+    write_csr(0x307, old_mtvt);
+    interrupt_global_enable();
+
+    report_class(class);
+    /* report() sorted the samples */
+    median[0] = entry[CLIC_BENCH_SAMPLES / 2];
+    median[1] = exit_[CLIC_BENCH_SAMPLES / 2];
+    median[2] = roundtrip[CLIC_BENCH_SAMPLES / 2];
+}
+
+static void report_saved(const char *class, const uint32_t base[3], const uint32_t median[3]) {
+
+    static const char * const metric[3] = { "entry_saved", "exit_saved", "roundtrip_saved" };
+    int32_t saved;
+    unsigned m;
+
+    for (m = 0; m < 3; m++) {
+        saved = (int32_t)(base[m] - median[m]);
+        printf("%s,%s,1,%d,%d,%d,%d\n", class, metric[m], (int)saved, (int)saved, (int)saved, (int)saved);
+    }
+}
+
+static void bench_handler_classes(void) {
+
+    uint32_t preemptible[3], fast[3], naked[3];
+
+    bench_handler_class("clic_software_preemptible", bench_preemptible_clic_software, preemptible);
+    bench_handler_class("clic_software_fast", bench_fast_clic_software, fast);
+    bench_handler_class("clic_software_naked", bench_naked_clic_software, naked);
+    report_saved("clic_software_fast", preemptible, fast);
+    report_saved("clic_software_naked", preemptible, naked);
+}
+
+/* Software Interrupt ID #3, triggered through this hart's MSIP */
+static void bench_software(void) {
+
+    uintptr_t msip = MSIP_BASE_ADDR(current_hartid());
+    uint32_t seq, trigger;
+    uint8_t ctl, ie;
+    unsigned i;
+
+    /* #3 also carries the mailbox, put its setup back afterwards */
+    ctl = read_byte(CLICINTCFG_ADDR(INT_ID_SOFTWARE));
+    ie = read_byte(CLICINTIE_ADDR(INT_ID_SOFTWARE));
+    write_byte(CLICINTCFG_ADDR(INT_ID_SOFTWARE), 255);
+    SOFTWARE_INT_ENABLE;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        seq = clic_bench_seq;
+        trigger = (uint32_t)read_csr(mcycle);
+        write_word(msip, 0x1);
+        record(i, seq, trigger);
+    }
+
+    write_byte(CLICINTIE_ADDR(INT_ID_SOFTWARE), ie);
+    write_byte(CLICINTCFG_ADDR(INT_ID_SOFTWARE), ctl);
+    report_class("software");
+}
+
+static volatile uint32_t mbox_pong_stamp;
+static volatile uint32_t mbox_pongs;
+
+static void bench_mbox_pong (unsigned from, uintptr_t arg) {
+
+    mbox_pong_stamp = (uint32_t)read_csr(mcycle);
+    mbox_pongs++;
+}
+
+static void bench_mbox_ping (unsigned from, uintptr_t arg) {
+
+    clic_mbox_send(from, bench_mbox_pong, arg);
+}
+
+static void bench_mbox_nop (unsigned from, uintptr_t arg) {
+}
+
+/* Inter-hart mailbox (clic_mbox.h) to the next hart, or to this one on a
+ * single hart design: ping -> pong round trip through both software
+ * interrupts, and the cost of a send that rings MSIP vs one that finds the
+ * ring already non-empty.  The sends go to this hart with interrupts off,
+ * so nothing drains the ring in between; another hart could, and the
+ * second send would ring again. */
+static void bench_mbox(void) {
+
+    unsigned to = (current_hartid() + 1) % CLIC_NUM_HARTS;
+    unsigned self = current_hartid();
+    uint32_t pongs, t0, t1;
+    uint8_t ctl, ie;
+    unsigned i;
+
+    ctl = read_byte(CLICINTCFG_ADDR(INT_ID_SOFTWARE));
+    ie = read_byte(CLICINTIE_ADDR(INT_ID_SOFTWARE));
+    write_byte(CLICINTCFG_ADDR(INT_ID_SOFTWARE), 255);
+    SOFTWARE_INT_ENABLE;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        pongs = mbox_pongs;
+        t0 = (uint32_t)read_csr(mcycle);
+        clic_mbox_send(to, bench_mbox_ping, 0);
+        while (mbox_pongs == pongs);
+        roundtrip[i] = mbox_pong_stamp - t0;
+    }
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        interrupt_global_disable();
+        t0 = (uint32_t)read_csr(mcycle);
+        clic_mbox_send(self, bench_mbox_nop, 0);
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+        t0 = (uint32_t)read_csr(mcycle);
+        clic_mbox_send(self, bench_mbox_nop, 0);
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[i] = t1 - t0;
+        interrupt_global_enable();
+    }
+
+    write_byte(CLICINTIE_ADDR(INT_ID_SOFTWARE), ie);
+    write_byte(CLICINTCFG_ADDR(INT_ID_SOFTWARE), ctl);
+    report("mbox", "pingpong", roundtrip);
+    report("mbox", "send_doorbell", entry);
+    report("mbox", "send_queued", exit_);
+}
+
+/* Timer Interrupt ID #7: SET_TIMER_INTERVAL_MS(0) with the mtime read and
+ * the mtimecmp address hoisted, so the trigger is the mtimecmp store */
+static void bench_timer(void) {
+
+    uintptr_t mtimecmp = MTIMECMP_BASE_ADDR(current_hartid());
+    uint32_t seq, trigger;
+    uint64_t now;
+    uint8_t ctl, ie;
+    unsigned i;
+
+    /* #7 also runs the software timers, put its setup back afterwards */
+    ctl = read_byte(CLICINTCFG_ADDR(INT_ID_TIMER));
+    ie = read_byte(CLICINTIE_ADDR(INT_ID_TIMER));
+    write_byte(CLICINTCFG_ADDR(INT_ID_TIMER), 255);
+    TIMER_INT_ENABLE;
+
+    /* timer_handler runs clic_timer_run(), which re-arms mtimecmp at the
+     * wheel's next deadline (parked with none pending), so every sample
+     * only has to pull mtimecmp in to now */
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        now = read_mtime();
+
+        seq = clic_bench_seq;
+        trigger = (uint32_t)read_csr(mcycle);
+        write_mtimecmp(mtimecmp, now);
+        record(i, seq, trigger);
+    }
+
+    write_byte(CLICINTIE_ADDR(INT_ID_TIMER), ie);
+    write_byte(CLICINTCFG_ADDR(INT_ID_TIMER), ctl);
+    report_class("timer");
+}
+
+/* read_mtime()/write_mtimecmp() as built, and the RV32 split sequences
+ * for comparison.  Written deadlines are never due. */
+static void bench_mtime(void) {
+
+    uintptr_t mtimecmp = MTIMECMP_BASE_ADDR(current_hartid());
+    uint32_t t0, t1;
+    volatile uint64_t sink;
+    unsigned i;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        t0 = (uint32_t)read_csr(mcycle);
+        sink = read_mtime();
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+
+        t0 = (uint32_t)read_csr(mcycle);
+        sink = read_mtime_split();
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[i] = t1 - t0;
+    }
+    (void)sink;
+    report("mtime", "read", entry);
+    report("mtime", "read_split", exit_);
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        t0 = (uint32_t)read_csr(mcycle);
+        write_mtimecmp(mtimecmp, UINT64_MAX - i);
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+
+        t0 = (uint32_t)read_csr(mcycle);
+        write_mtimecmp_split(mtimecmp, UINT64_MAX - i);
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[i] = t1 - t0;
+    }
+    write_mtimecmp(mtimecmp, UINT64_MAX);
+    report("mtimecmp", "write", entry);
+    report("mtimecmp", "write_split", exit_);
+}
+
+/* Hart-local MSIP address the way handlers used to get it (csrr mhartid
+ * and the address arithmetic) vs one load from the tp context block */
+static void bench_ctx(void) {
+
+    volatile uintptr_t sink;
+    uint32_t t0, t1;
+    unsigned i;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        t0 = (uint32_t)read_csr(mcycle);
+        sink = MSIP_BASE_ADDR(read_csr(mhartid));
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+
+        t0 = (uint32_t)read_csr(mcycle);
+        sink = clic_ctx()->msip;
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[i] = t1 - t0;
+    }
+    (void)sink;
+    report("hart_ctx", "mhartid", entry);
+    report("hart_ctx", "tp", exit_);
+}
+
+/* An empty section the old way, clearing and restoring mstatus.MIE, and
+ * the way the library does it now */
+static void bench_crit(void) {
+
+    uintptr_t mstatus;
+    clic_crit_t crit;
+    uint32_t t0, t1;
+    unsigned i;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        t0 = (uint32_t)read_csr(mcycle);
+        mstatus = clear_csr(mstatus, METAL_MIE_INTERRUPT);
+        if (mstatus & METAL_MIE_INTERRUPT)
+            set_csr(mstatus, METAL_MIE_INTERRUPT);
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+
+        t0 = (uint32_t)read_csr(mcycle);
+        crit = clic_crit_enter(CLIC_CRIT_ALL);
+        clic_crit_exit(crit);
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[i] = t1 - t0;
+    }
+    report("crit", "mie", entry);
+    report("crit", "thresh", exit_);
+}
+
+#if CLIC_STATS
+/* CLIC_STATS_ENTRY() + CLIC_STATS_EXIT() with nothing in between, what
+ * CLIC_STATS=1 adds to every instrumented handler */
+static void bench_stats(void) {
+
+    uint32_t t0, t1;
+    unsigned i;
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        t0 = (uint32_t)read_csr(mcycle);
+        {
+            CLIC_STATS_ENTRY();
+            CLIC_STATS_EXIT();
+        }
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+    }
+    clic_stats_reset();
+    report("stats", "hooks", entry);
+}
+#endif
+
+#if CLIC_HIST
+static void __attribute__((CLIC_PREEMPTIBLE)) bench_hist_handler (void) {
+
+    CLIC_STATS_ENTRY();
+    write_byte(CLICINTIP_ADDR(CLIC_HIST_FIRST), DISABLE);
+    CLIC_BENCH_EXIT();
+    CLIC_STATS_EXIT();
+}
+
+/* CLIC_HIST_FIRST pended with CLIC_HIST_PEND() through bench_mtvt, then
+ * the line's histograms as a second CSV table */
+static void bench_hist(void) {
+
+    uintptr_t old_mtvt = read_csr(0x307);
+    clic_hist_line_t snapshot;
+    uint8_t ctl, ie;
+    uint32_t seq;
+    unsigned i, id;
+
+    interrupt_global_disable();
+    for (id = 0; id < CLIC_VECTOR_TABLE_SIZE_MAX; id++)
+        bench_mtvt[id] = ((const uintptr_t *)old_mtvt)[id];
+    bench_mtvt[CLIC_HIST_FIRST] = (uintptr_t)&bench_hist_handler;
+    fence_i();
+    write_csr(0x307, (uintptr_t)&bench_mtvt);
+    ctl = read_byte(CLICINTCFG_ADDR(CLIC_HIST_FIRST));
+    ie = read_byte(CLICINTIE_ADDR(CLIC_HIST_FIRST));
+    write_byte(CLICINTCFG_ADDR(CLIC_HIST_FIRST), 255);
+    write_byte(CLICINTIE_ADDR(CLIC_HIST_FIRST), ENABLE);
+    clic_hist_snapshot(CLIC_HIST_FIRST, &snapshot);
+    interrupt_global_enable();
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        seq = clic_bench_seq;
+        CLIC_HIST_PEND(CLIC_HIST_FIRST);
+        while (clic_bench_seq == seq);
+    }
+
+    interrupt_global_disable();
+    write_byte(CLICINTIE_ADDR(CLIC_HIST_FIRST), ie);
+    write_byte(CLICINTCFG_ADDR(CLIC_HIST_FIRST), ctl);
+    write_csr(0x307, old_mtvt);
+    interrupt_global_enable();
+
+    clic_hist_snapshot(CLIC_HIST_FIRST, &snapshot);
+    printf("\n");
+    clic_hist_print_header();
+    clic_hist_print(CLIC_HIST_FIRST, &snapshot);
+}
+#endif
+
+/* Local external lines 16-47, or as many as the design has */
+#define BURST_FIRST             MAX_LOCAL_INTS
+#define BURST_LINES             (METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS - BURST_FIRST < 32 ? \
+                                 METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS - BURST_FIRST : 32)
+
+static volatile uint32_t burst_left;
+
+static void __attribute__((CLIC_PREEMPTIBLE)) bench_burst_vectored (void) {
+
+    write_byte(CLICINTIP_ADDR(MCAUSE_CODE(read_csr(mcause))), DISABLE);
+    burst_left--;
+}
+
+/* Same body as a plain function, called by clic_nxti_dispatch() */
+static void bench_burst_work (void) {
+
+    write_byte(CLICINTIP_ADDR(MCAUSE_CODE(read_csr(mcause))), DISABLE);
+    burst_left--;
+}
+
+/* mtvec 0 keeps the current mtvec.base */
+static void bench_burst(const char *class, uintptr_t mtvec, uint8_t nvbits, uint8_t ctl, void (*handler)(void)) {
+
+    uintptr_t old_mtvec = read_csr(mtvec);
+    uintptr_t old_mtvt = read_csr(0x307);
+    uint8_t old_cliccfg = read_byte(CLICCFG_ADDR);
+    uint8_t old_ie[BURST_LINES], old_ctl[BURST_LINES];
+    uint32_t t0, t1;
+    unsigned i, id;
+
+    interrupt_global_disable();
+
+    for (id = 0; id < CLIC_VECTOR_TABLE_SIZE_MAX; id++)
+        bench_mtvt[id] = (uintptr_t)handler;
+    write_csr(0x307, (uintptr_t)&bench_mtvt);
+    if (!mtvec)
+        mtvec = old_mtvec & ~(uintptr_t)0x3F;
+    write_csr(mtvec, (mtvec | MTVEC_MODE_CLIC_VECTORED));
+    write_byte(CLICCFG_ADDR, (old_cliccfg & ~CLICCFG_NVBITS(1)) | CLICCFG_NVBITS(nvbits));
+
+    for (id = 0; id < BURST_LINES; id++) {
+        old_ie[id] = read_byte(CLICINTIE_ADDR(BURST_FIRST + id));
+        old_ctl[id] = read_byte(CLICINTCFG_ADDR(BURST_FIRST + id));
+        write_byte(CLICINTCFG_ADDR(BURST_FIRST + id), ctl);
+        write_byte(CLICINTIP_ADDR(BURST_FIRST + id), DISABLE);
+        write_byte(CLICINTIE_ADDR(BURST_FIRST + id), ENABLE);
+    }
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        for (id = 0; id < BURST_LINES; id++)
+            write_byte(CLICINTIP_ADDR(BURST_FIRST + id), ENABLE);
+        burst_left = BURST_LINES;
+
+        t0 = (uint32_t)read_csr(mcycle);
+        interrupt_global_enable();
+        while (burst_left);
+        t1 = (uint32_t)read_csr(mcycle);
+        interrupt_global_disable();
+
+        roundtrip[i] = t1 - t0;
+        entry[i] = (t1 - t0) / BURST_LINES;
+    }
+
+    for (id = 0; id < BURST_LINES; id++) {
+        write_byte(CLICINTIE_ADDR(BURST_FIRST + id), old_ie[id]);
+        write_byte(CLICINTCFG_ADDR(BURST_FIRST + id), old_ctl[id]);
+    }
+    write_byte(CLICCFG_ADDR, old_cliccfg);
+    write_csr(mtvec, old_mtvec);
+    write_csr(0x307, old_mtvt);
+
+    interrupt_global_enable();
+
+    report(class, "burst", roundtrip);
+    report(class, "per_irq", entry);
+}
+
+/* A device FIFO of POLL_FIFO entries behind a level triggered line, which
+ * drops once the FIFO is empty */
+#define POLL_FIFO               16
+
+static volatile uint32_t poll_fifo;
+
+static void bench_poll_event (clic_poll_t *poll) {
+
+    if (--poll_fifo == 0)
+        write_byte(CLICINTIP_ADDR(poll->int_id), DISABLE);
+}
+
+/* Never switches to polling by itself, enter is out of reach */
+static clic_poll_t bench_poll_line = CLIC_POLL_INIT(BURST_FIRST, bench_poll_event, POLL_FIFO,
+                                                    UINT32_MAX, 0, UINT32_MAX, 1);
+
+static void __attribute__((CLIC_PREEMPTIBLE)) bench_poll_handler (void) {
+
+    clic_poll_irq(&bench_poll_line);
+}
+
+/* Cost per event of draining the FIFO through clic_poll_irq(), one trap
+ * per entry, and through one clic_poll_run() with the line disabled */
+static void bench_poll(void) {
+
+    uintptr_t old_mtvt = read_csr(0x307);
+    uint8_t ctl, ie;
+    uint32_t t0, t1;
+    unsigned i, id;
+
+    interrupt_global_disable();
+    for (id = 0; id < CLIC_VECTOR_TABLE_SIZE_MAX; id++)
+        bench_mtvt[id] = ((const uintptr_t *)old_mtvt)[id];
+    bench_mtvt[BURST_FIRST] = (uintptr_t)&bench_poll_handler;
+    fence_i();
+    write_csr(0x307, (uintptr_t)&bench_mtvt);
+    ctl = read_byte(CLICINTCFG_ADDR(BURST_FIRST));
+    ie = read_byte(CLICINTIE_ADDR(BURST_FIRST));
+    write_byte(CLICINTCFG_ADDR(BURST_FIRST), 255);
+    write_byte(CLICINTIE_ADDR(BURST_FIRST), ENABLE);
+
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        poll_fifo = POLL_FIFO;
+        write_byte(CLICINTIP_ADDR(BURST_FIRST), ENABLE);
+        t0 = (uint32_t)read_csr(mcycle);
+        interrupt_global_enable();
+        while (poll_fifo);
+        t1 = (uint32_t)read_csr(mcycle);
+        interrupt_global_disable();
+        entry[i] = (t1 - t0) / POLL_FIFO;
+    }
+
+    write_byte(CLICINTIE_ADDR(BURST_FIRST), DISABLE);
+    for (i = 0; i < CLIC_BENCH_SAMPLES; i++) {
+        poll_fifo = POLL_FIFO;
+        write_byte(CLICINTIP_ADDR(BURST_FIRST), ENABLE);
+        t0 = (uint32_t)read_csr(mcycle);
+        clic_poll_run(&bench_poll_line);
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[i] = (t1 - t0) / POLL_FIFO;
+    }
+
+    write_byte(CLICINTIE_ADDR(BURST_FIRST), ie);
+    write_byte(CLICINTCFG_ADDR(BURST_FIRST), ctl);
+    write_csr(0x307, old_mtvt);
+    interrupt_global_enable();
+
+    report("poll", "irq_per_event", entry);
+    report("poll", "polled_per_event", exit_);
+}
+
+static clic_timer_t wheel_timers[CLIC_BENCH_SAMPLES];
+static uint32_t wheel_expired;
+
+static void bench_wheel_expired (clic_timer_t *timer) {
+
+    wheel_expired++;
+}
+
+/* Software timer wheel with n timers pending: cost of each start, of each
+ * cancel (every other timer), and of the clic_timer_process() calls that
+ * expire the rest, per expired timer.  Deadlines are spread over 2^20 ticks
+ * so every level of the wheel is used.  The timer interrupt is off and the
+ * wheel is driven with synthetic time, so nothing waits for mtime. */
+static void bench_wheel(unsigned n) {
+
+    uint64_t base, now, next;
+    uint32_t rnd = 12345, t0, t1, cycles = 0;
+    unsigned i, cancelled = 0;
+    char class[24];
+
+    TIMER_INT_DISABLE;
+    base = clic_timer_now();
+    clic_timer_reset(base);
+
+    for (i = 0; i < n; i++) {
+        rnd = rnd * 1664525 + 1013904223;
+        wheel_timers[i] = (clic_timer_t)CLIC_TIMER_INIT(bench_wheel_expired);
+        t0 = (uint32_t)read_csr(mcycle);
+        clic_timer_start(&wheel_timers[i], base + 1 + (rnd >> 12));
+        t1 = (uint32_t)read_csr(mcycle);
+        entry[i] = t1 - t0;
+    }
+    for (i = 0; i < n; i += 2) {
+        t0 = (uint32_t)read_csr(mcycle);
+        clic_timer_cancel(&wheel_timers[i]);
+        t1 = (uint32_t)read_csr(mcycle);
+        exit_[cancelled++] = t1 - t0;
+    }
+
+    wheel_expired = 0;
+    now = base;
+    while (1) {
+        t0 = (uint32_t)read_csr(mcycle);
+        next = clic_timer_process(now);
+        t1 = (uint32_t)read_csr(mcycle);
+        cycles += t1 - t0;
+        if (next == UINT64_MAX)
+            break;
+        now = next;
+    }
+    roundtrip[0] = wheel_expired ? cycles / wheel_expired : 0;
+
+    snprintf(class, sizeof(class), "timer_wheel_%u", n);
+    report_n(class, "start", entry, n);
+    report_n(class, "cancel", exit_, cancelled);
+    report_n(class, "expire", roundtrip, 1);
+
+    clic_timer_init();
+    TIMER_INT_ENABLE;
+}
+
+void clic_bench_run(void) {
+
+    uint32_t t0, t1, overhead = UINT32_MAX;
+    unsigned i;
+
+    /* Cost of the stamps themselves, not subtracted from the results */
+    for (i = 0; i < 16; i++) {
+        t0 = (uint32_t)read_csr(mcycle);
+        t1 = (uint32_t)read_csr(mcycle);
+        if (t1 - t0 < overhead)
+            overhead = t1 - t0;
+    }
+
+    printf("class,metric,samples,min,median,p99,max\n");
+    printf("mcycle_read,overhead,16,%u,%u,%u,%u\n",
+           (unsigned)overhead, (unsigned)overhead, (unsigned)overhead, (unsigned)overhead);
+
+    bench_clic_software();
+    bench_clic_software_direct();
+    bench_handler_classes();
+    bench_software();
+    bench_mbox();
+    bench_timer();
+    bench_mtime();
+    bench_ctx();
+    bench_crit();
+#if CLIC_STATS
+    bench_stats();
+#endif
+
+    /* shv set and NVBITS = 0: every line is vectored to its own handler;
+     * shv clear and NVBITS = 1: every line traps to the dispatcher */
+    bench_burst("burst_vectored", 0, 0, 0xFF, bench_burst_vectored);
+    bench_burst("burst_nxti", (uintptr_t)&clic_nxti_trap, 1, 0xFE, bench_burst_work);
+    bench_poll();
+
+    bench_wheel(16);
+    bench_wheel(64);
+    bench_wheel(CLIC_BENCH_SAMPLES);
+#if CLIC_HIST
+    bench_hist();
+#endif
+#if CLIC_CRIT_STATS
+    printf("\n");
+    clic_crit_report();
+#endif
+}
+
+#endif /* CLIC_BENCHMARK */
@@ -0,0 +1,49 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * mcycle based interrupt latency benchmark, built with CLIC_BENCHMARK=1
+ * (see the "bench" and "host-bench" targets in the Makefile).
+ *
+ * The handlers under test mark their first and last statement with
+ * CLIC_BENCH_ENTRY()/CLIC_BENCH_EXIT(); both compile to nothing in the
+ * normal build.
+ */
+
+#ifndef CLIC_BENCH_H
+#define CLIC_BENCH_H
+
+#include "clic_hal.h"
+
+#ifndef CLIC_BENCHMARK
+#define CLIC_BENCHMARK                  0
+#endif
+
+/* Samples per interrupt class, the buffers are reused from class to class */
+#ifndef CLIC_BENCH_SAMPLES
+#define CLIC_BENCH_SAMPLES              256
+#endif
+
+#if CLIC_BENCHMARK
+
+extern volatile uint32_t clic_bench_entry_stamp;
+extern volatile uint32_t clic_bench_exit_stamp;
+extern volatile uint32_t clic_bench_seq;
+
+#define CLIC_BENCH_ENTRY()              (clic_bench_entry_stamp = (uint32_t)read_csr(mcycle))
+#define CLIC_BENCH_EXIT()               do { clic_bench_exit_stamp = (uint32_t)read_csr(mcycle); \
+                                             clic_bench_seq++; } while (0)
+
+/* Run every interrupt class and print the results as CSV on stdout, which
+ * the BSP routes to the UART (or to the debugger with semihosting).
+ * Expects mtvec/mtvt/cliccfg to be set up and interrupts enabled. */
+void clic_bench_run(void);
+
+#else
+
+#define CLIC_BENCH_ENTRY()
+#define CLIC_BENCH_EXIT()
+
+#endif /* CLIC_BENCHMARK */
+
+#endif /* CLIC_BENCH_H */
@@ -0,0 +1,81 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <stdio.h>
+
+#include "clic_crash.h"
+#include "clic_trace.h"
+
+/* Not loaded or zeroed by crt0, so records survive a reset */
+#if CLIC_HOST_MODEL
+#define NOINIT
+#else
+#define NOINIT                  __attribute__((section(".noinit.clic_crash")))
+#endif
+
+NOINIT clic_crash_log_t clic_crash_log[CLIC_NUM_HARTS];
+NOINIT uint8_t __attribute__((aligned(16))) clic_crash_stack[CLIC_NUM_HARTS * CLIC_CRASH_STACK_SIZE];
+
+void __attribute__((weak, noreturn)) clic_crash_halt(void) {
+
+    while (1);
+}
+
+void clic_crash_capture(uintptr_t sp, uintptr_t ra) {
+
+    uintptr_t hartid = read_csr(mhartid);
+    clic_crash_log_t *log = &clic_crash_log[hartid];
+    clic_crash_rec_t *rec;
+
+    /* Power on garbage, or a build with another layout */
+    if (log->magic != CLIC_CRASH_MAGIC || log->xlen != sizeof(uintptr_t) * 8 ||
+        log->depth != CLIC_CRASH_DEPTH || log->rec_size != sizeof(clic_crash_rec_t)) {
+        log->head = 0;
+        log->xlen = sizeof(uintptr_t) * 8;
+        log->depth = CLIC_CRASH_DEPTH;
+        log->rec_size = sizeof(clic_crash_rec_t);
+        log->reserved = 0;
+        log->magic = CLIC_CRASH_MAGIC;
+    }
+
+    rec = &log->rec[log->head % CLIC_CRASH_DEPTH];
+    rec->mcause = read_csr(mcause);
+    rec->mepc = read_csr(mepc);
+    rec->mtval = read_csr(mtval);
+    rec->sp = sp;
+    rec->ra = ra;
+    rec->mcycle = (uint32_t)read_csr(mcycle);
+    rec->seq = log->head;
+    rec->hartid = (uint8_t)hartid;
+    rec->level = (uint8_t)MINTSTATUS_MIL(read_csr(0x346));     /* 0x346 is mintstatus */
+    rec->reserved = 0;
+    log->head++;
+
+#if CLIC_TRACE
+    /* The last thing in the trace, then freeze it for the debugger.  By
+     * mhartid as well, clic_trace_event() would go through tp. */
+    clic_trace_log(&clic_trace[hartid], CLIC_TRACE_EV_EXCEPTION, (unsigned)MCAUSE_CODE(rec->mcause));
+    clic_trace[hartid].mode = CLIC_TRACE_OFF;
+#endif
+    clic_crash_halt();
+}
+
+unsigned clic_crash_dump(void) {
+
+    const uint8_t *p;
+    unsigned hart, i, n, records = 0;
+
+    for (hart = 0; hart < CLIC_NUM_HARTS; hart++) {
+        if (clic_crash_log[hart].magic != CLIC_CRASH_MAGIC || !clic_crash_log[hart].head)
+            continue;
+        n = clic_crash_log[hart].head < CLIC_CRASH_DEPTH ? clic_crash_log[hart].head : CLIC_CRASH_DEPTH;
+        records += n;
+
+        p = (const uint8_t *)&clic_crash_log[hart];
+        printf("clic_crash ");
+        for (i = 0; i < sizeof(clic_crash_log[hart]); i++)
+            printf("%02x", p[i]);
+        printf("\n");
+    }
+    return records;
+}
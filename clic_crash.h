@@ -0,0 +1,117 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Crash capture into a ring in no-init RAM.
+ *
+ * default_exception_handler used to spin with the cause in locals nobody
+ * could see.  It is now CLIC_CRASH_ENTRY(): it moves to a small crash stack
+ * of its own (the fault may well be a blown stack) and jumps to
+ * clic_crash_capture(), which appends
+ *
+ *   mcause, mepc, mtval, sp, ra     as they were at the fault
+ *   mintstatus.mil, hart, mcycle    where and when
+ *
+ * to the hart's clic_crash_log and stops in clic_crash_halt().  Nothing
+ * runs until a fault: the log is not set up at boot but recognised by its
+ * magic word, and set up on the first fault after power on.
+ *
+ * The log lives in .noinit, which crt0 neither loads nor zeroes, so after
+ * a watchdog or debugger reset the records are still there.  The linker
+ * script needs a NOLOAD output section for it outside .bss, e.g.
+ *
+ *   .noinit (NOLOAD) : { *(.noinit .noinit.*) } >ram
+ *
+ * clic_crash_dump() prints the logs as hex lines, which tools/clic_crash_decode
+ * turns into a report, as does a raw memory dump of clic_crash_log.
+ */
+
+#ifndef CLIC_CRASH_H
+#define CLIC_CRASH_H
+
+#include "clic_hal.h"
+
+/* Records kept per hart, the oldest is overwritten */
+#ifndef CLIC_CRASH_DEPTH
+#define CLIC_CRASH_DEPTH                        8
+#endif
+
+/* Stack clic_crash_capture() runs on, per hart, as a power of two */
+#define CLIC_CRASH_STACK_SHIFT                  8
+#define CLIC_CRASH_STACK_SIZE                   (1 << CLIC_CRASH_STACK_SHIFT)
+
+#define CLIC_CRASH_MAGIC                        0xC1C0FA17UL
+
+/* Layout shared with tools/clic_crash_decode.c: a 16-byte header, then
+ * the records, all little endian in the target's XLEN */
+typedef struct clic_crash_rec {
+    uintptr_t mcause;
+    uintptr_t mepc;
+    uintptr_t mtval;
+    uintptr_t sp;
+    uintptr_t ra;
+    uint32_t mcycle;                /* low word */
+    uint32_t seq;                   /* running record number */
+    uint8_t hartid;
+    uint8_t level;                  /* mintstatus.mil at the fault */
+    uint16_t reserved;
+} clic_crash_rec_t;
+
+typedef struct clic_crash_log {
+    uint32_t magic;
+    uint32_t head;                  /* records written since the log was set up */
+    uint8_t xlen;
+    uint8_t depth;
+    uint16_t rec_size;
+    uint32_t reserved;
+    clic_crash_rec_t rec[CLIC_CRASH_DEPTH];
+} clic_crash_log_t;
+
+extern clic_crash_log_t clic_crash_log[CLIC_NUM_HARTS];
+
+/* Record a fault and halt.  sp and ra are the faulting context's. */
+void __attribute__((noreturn)) clic_crash_capture(uintptr_t sp, uintptr_t ra);
+
+/* Where clic_crash_capture() ends, spinning by default.  Override to reset
+ * the hart or hand over to a debugger. */
+void __attribute__((noreturn)) clic_crash_halt(void);
+
+/* Print every hart's log that holds records as "clic_crash <hex>" lines,
+ * returns the number of records */
+unsigned clic_crash_dump(void);
+
+/* Body of a trap handler declared CLIC_CRASH_HANDLER */
+#if CLIC_HOST_MODEL
+
+#define CLIC_CRASH_HANDLER
+#define CLIC_CRASH_ENTRY()                      clic_crash_capture(read_sp(), (uintptr_t)__builtin_return_address(0))
+
+#else
+
+#define CLIC_CRASH_HANDLER                      naked
+
+#define CLIC_CRASH_STR_(x)                      #x
+#define CLIC_CRASH_STR(x)                       CLIC_CRASH_STR_(x)
+
+#if CLIC_NUM_HARTS > 1
+/* mhartid, not tp: the fault may have come from anywhere */
+#define CLIC_CRASH_STACK_ASM                    "csrr t0, mhartid\n"                        \
+                                                "addi t0, t0, 1\n"                          \
+                                                "slli t0, t0, " CLIC_CRASH_STR(CLIC_CRASH_STACK_SHIFT) "\n" \
+                                                "la sp, clic_crash_stack\n"                 \
+                                                "add sp, sp, t0\n"
+#else
+#define CLIC_CRASH_STACK_ASM                    "la sp, clic_crash_stack + " CLIC_CRASH_STR(CLIC_CRASH_STACK_SIZE) "\n"
+#endif
+
+/* For naked trap front-ends that pick the crash path themselves */
+#define CLIC_CRASH_ENTRY_ASM                    "mv a0, sp\n"                               \
+                                                "mv a1, ra\n"                               \
+                                                CLIC_CRASH_STACK_ASM                        \
+                                                "j clic_crash_capture\n"
+
+#define CLIC_CRASH_ENTRY()                      __asm__ volatile (CLIC_CRASH_ENTRY_ASM)
+
+#endif /* CLIC_HOST_MODEL */
+
+#endif /* CLIC_CRASH_H */
@@ -0,0 +1,38 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <stdio.h>
+
+#include "clic_crit.h"
+
+#if CLIC_CRIT_STATS
+
+uint32_t clic_crit_max_cycles[CLIC_CRIT_LEVELS];
+
+uint32_t clic_crit_max_window(uint8_t level) {
+
+    return clic_crit_max_cycles[CLIC_CRIT_SLOT(level)];
+}
+
+void clic_crit_report(void) {
+
+    unsigned i;
+
+    printf("level,max_cycles\n");
+    for (i = 0; i < CLIC_CRIT_LEVELS; i++) {
+        if (clic_crit_max_cycles[i])
+            printf("%u,%u\n", (i << (8 - METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS)) |
+                              (0xFFu >> METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS),
+                   (unsigned)clic_crit_max_cycles[i]);
+    }
+}
+
+void clic_crit_reset(void) {
+
+    unsigned i;
+
+    for (i = 0; i < CLIC_CRIT_LEVELS; i++)
+        clic_crit_max_cycles[i] = 0;
+}
+
+#endif /* CLIC_CRIT_STATS */
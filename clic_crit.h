@@ -0,0 +1,106 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Critical sections on the CLIC interrupt threshold (mintthresh) instead of
+ * mstatus.MIE.
+ *
+ * clic_crit_enter(level) masks only interrupts at or below level, so lines
+ * above the ceiling keep being taken inside the section.  Levels use the
+ * clicintctl encoding (see the clicintcfg notes in main()), e.g. with
+ * NLBITS = 2 a ceiling of 127 masks levels 63 and 127 and leaves 191 and
+ * 255 live.  Sections nest, and an inner section never lowers the
+ * threshold set by an outer one or by a handler (priority ceiling):
+ *
+ *   clic_crit_t c = clic_crit_enter(127);
+ *   ... data shared with level 63/127 handlers ...
+ *   clic_crit_exit(c);
+ *
+ * Handlers that enter a section must leave it before returning.  A ceiling
+ * below the level of the running handler masks nothing new, the CLIC
+ * already holds those levels off.
+ *
+ * CLIC_CRIT_ALL masks every line, for data that handlers of any level
+ * touch.  The library's own short sections (timer wheel, deferred work
+ * queue, mailbox send, trace, statistics, stack marks, histograms) use it
+ * instead of clearing mstatus.MIE, so CLIC_CRIT_STATS covers them too.
+ * Only the mnxti dispatcher and the global enable/disable in clic_hal.h
+ * still work on mstatus.MIE.
+ *
+ * With CLIC_CRIT_STATS=1 the longest window each ceiling kept interrupts
+ * masked is recorded in mcycle, see clic_crit_max_window().
+ */
+
+#ifndef CLIC_CRIT_H
+#define CLIC_CRIT_H
+
+#include "clic_hal.h"
+
+#ifndef CLIC_CRIT_STATS
+#define CLIC_CRIT_STATS                         0
+#endif
+
+/* One statistics slot per implemented clicintctl value */
+#define CLIC_CRIT_LEVELS                        (1 << METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS)
+#define CLIC_CRIT_SLOT(level)                   ((uint8_t)(level) >> (8 - METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS))
+
+/* Ceiling above every level, the section runs with all lines masked */
+#define CLIC_CRIT_ALL                           255
+
+typedef struct {
+    uint8_t prev;           /* threshold to restore */
+    uint8_t raised;         /* threshold this section set, 0 if it did not raise it */
+#if CLIC_CRIT_STATS
+    uint32_t start;
+#endif
+} clic_crit_t;
+
+#if CLIC_CRIT_STATS
+extern uint32_t clic_crit_max_cycles[CLIC_CRIT_LEVELS];
+#endif
+
+/* 0x347 is the CLIC mintthresh CSR.  A handler that runs between the read
+ * and the write restores the threshold before returning, so the pair needs
+ * no protection. */
+static inline __attribute__((always_inline)) clic_crit_t clic_crit_enter (uint8_t level) {
+
+    clic_crit_t c;
+
+    c.prev = (uint8_t)read_csr(0x347);
+    c.raised = 0;
+    if (level > c.prev) {
+        write_csr(0x347, level);
+        c.raised = level;
+#if CLIC_CRIT_STATS
+        c.start = (uint32_t)read_csr(mcycle);
+#endif
+    }
+    return c;
+}
+
+static inline __attribute__((always_inline)) void clic_crit_exit (clic_crit_t c) {
+
+    if (!c.raised)
+        return;
+#if CLIC_CRIT_STATS
+    {
+        uint32_t window = (uint32_t)read_csr(mcycle) - c.start;
+
+        if (window > clic_crit_max_cycles[CLIC_CRIT_SLOT(c.raised)])
+            clic_crit_max_cycles[CLIC_CRIT_SLOT(c.raised)] = window;
+    }
+#endif
+    write_csr(0x347, c.prev);
+}
+
+#if CLIC_CRIT_STATS
+/* Longest masked window, in mcycle, of sections with the given ceiling */
+uint32_t clic_crit_max_window(uint8_t level);
+
+/* Print "level,max_cycles" for every ceiling used so far, as CSV on stdout */
+void clic_crit_report(void);
+
+void clic_crit_reset(void);
+#endif
+
+#endif /* CLIC_CRIT_H */
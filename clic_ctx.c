@@ -0,0 +1,25 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_ctx.h"
+#include "clic_stats.h"
+
+clic_ctx_t clic_ctx_table[CLIC_NUM_HARTS];
+
+void clic_ctx_init(void) {
+
+    /* The one mhartid read, everything after goes through tp */
+    uintptr_t hartid = read_csr(mhartid);
+    clic_ctx_t *ctx = &clic_ctx_table[hartid];
+
+    ctx->hartid = hartid;
+    ctx->msip = MSIP_BASE_ADDR(hartid);
+    ctx->mtimecmp = MTIMECMP_BASE_ADDR(hartid);
+    ctx->clic = HART_CLIC_BASE_ADDR(hartid);
+    ctx->timer_armed = UINT64_MAX;
+    ctx->doorbells = 0;
+    ctx->messages = 0;
+    ctx->stats_active = CLIC_STATS_NONE;
+
+    write_tp(ctx);
+}
@@ -0,0 +1,51 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Per-hart context block, reachable through the tp register.
+ *
+ * Hart-local state that handlers need on every interrupt (the hart ID, the
+ * MSIP/mtimecmp/CLIC addresses derived from it, the armed timer deadline
+ * and a few counters) is computed once by clic_ctx_init() and kept in one
+ * block per hart.  tp points at it, so clic_ctx()->msip is one load instead
+ * of a csrr of mhartid followed by the address arithmetic.
+ *
+ * clic_ctx_init() must be the first thing every hart runs: current_hartid()
+ * and everything built on it read the block on multi-hart designs.  tp is
+ * taken over for this, the example uses no thread local storage.  mscratch
+ * is left alone for the trap handlers.
+ */
+
+#ifndef CLIC_CTX_H
+#define CLIC_CTX_H
+
+#include "clic_hal.h"
+
+typedef struct clic_ctx {
+    uintptr_t hartid;
+    uintptr_t msip;                 /* MSIP_BASE_ADDR(hartid) */
+    uintptr_t mtimecmp;             /* MTIMECMP_BASE_ADDR(hartid) */
+    uintptr_t clic;                 /* HART_CLIC_BASE_ADDR(hartid) */
+
+    /* Software timers (clic_timer.c) */
+    uint64_t timer_armed;           /* current mtimecmp */
+
+    /* Mailbox (clic_mbox.c) */
+    uint32_t doorbells;             /* clic_mbox_run() calls */
+    uint32_t messages;              /* messages run */
+
+    /* Statistics (clic_stats.h) */
+    uint16_t stats_active;          /* ID of the running handler */
+} clic_ctx_t;
+
+extern clic_ctx_t clic_ctx_table[CLIC_NUM_HARTS];
+
+static inline __attribute__((always_inline)) clic_ctx_t *clic_ctx (void) {
+
+    return (clic_ctx_t *)read_tp();
+}
+
+/* Fill the calling hart's block and point tp at it */
+void clic_ctx_init(void);
+
+#endif /* CLIC_CTX_H */
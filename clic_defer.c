@@ -0,0 +1,30 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_defer.h"
+
+struct clic_defer_queue clic_defer_queue = { NULL, &clic_defer_queue.head };
+
+void clic_defer_run(void) {
+
+    clic_work_t *work, *next;
+    clic_crit_t crit;
+
+    while (1) {
+        /* Detach everything queued so far, new work starts a new batch */
+        crit = clic_crit_enter(CLIC_CRIT_ALL);
+        work = clic_defer_queue.head;
+        clic_defer_queue.head = NULL;
+        clic_defer_queue.tail = &clic_defer_queue.head;
+        clic_crit_exit(crit);
+
+        if (!work)
+            break;
+
+        for (; work; work = next) {
+            next = work->next;
+            work->queued = 0;
+            work->fn(work);
+        }
+    }
+}
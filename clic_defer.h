@@ -0,0 +1,86 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Deferred work (bottom halves) run from the CLIC software interrupt #12.
+ *
+ * A handler that has more to do than acknowledging its device queues a
+ * work item and returns; clic_defer() pends interrupt #12, whose handler
+ * calls clic_defer_run() to run every queued item in FIFO order:
+ *
+ *   static void rx_work (clic_work_t *work) { ... heavy processing ... }
+ *   static clic_work_t rx = CLIC_WORK_INIT(rx_work);
+ *
+ *   in lc0_handler:     clic_defer(&rx);
+ *
+ * Give #12 the lowest level in CLIC_IRQ_MAP: with cliccfg.NLBITS > 0 (main()
+ * uses CLIC_NLBITS, 1 by default) every other line then preempts the
+ * deferred work, and the work itself runs once the handlers that queued it
+ * have returned.  With NLBITS = 0 it still runs last, as the lowest
+ * priority, but cannot be preempted.
+ *
+ * An item is queued at most once; queueing it again before it has started
+ * running is a no-op, so N events can be handled by one run.  Items may
+ * queue themselves again from their function.
+ */
+
+#ifndef CLIC_DEFER_H
+#define CLIC_DEFER_H
+
+#include <stddef.h>
+
+#include "clic_hal.h"
+#include "clic_crit.h"
+#include "clic_trace.h"
+
+typedef struct clic_work {
+    struct clic_work *next;
+    void (*fn)(struct clic_work *work);
+    volatile uint8_t queued;
+} clic_work_t;
+
+#define CLIC_WORK_INIT(fn)                      { NULL, (fn), 0 }
+
+struct clic_defer_queue {
+    clic_work_t *head;
+    clic_work_t **tail;
+};
+
+extern struct clic_defer_queue clic_defer_queue;
+
+/* Queue work from any context.  Interrupts are held off for the few
+ * instructions of the list update, since handlers of every level may
+ * queue.  #12 is only pended when the queue goes from empty to non-empty.
+ * Returns 0 if the item was already queued. */
+static inline __attribute__((always_inline)) int clic_defer (clic_work_t *work) {
+
+    clic_crit_t crit;
+    int kick;
+
+    if (work->queued)
+        return 0;
+
+    crit = clic_crit_enter(CLIC_CRIT_ALL);
+    if (work->queued) {
+        clic_crit_exit(crit);
+        return 0;
+    }
+    kick = clic_defer_queue.head == NULL;
+    work->queued = 1;
+    work->next = NULL;
+    *clic_defer_queue.tail = work;
+    clic_defer_queue.tail = &work->next;
+    clic_crit_exit(crit);
+
+    if (kick) {
+        CLIC_TRACE_PEND(INT_ID_CLIC_SOFTWARE);
+        write_byte(CLICINTIP_ADDR(INT_ID_CLIC_SOFTWARE), ENABLE);
+    }
+    return 1;
+}
+
+/* Run queued work until the queue is empty, one detached batch at a time.
+ * Called by clic_software_handler after it cleared the pending bit. */
+void clic_defer_run(void);
+
+#endif /* CLIC_DEFER_H */
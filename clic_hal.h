@@ -0,0 +1,329 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * CLIC/CLINT register map and low level access layer shared by the
+ * example and its helper modules.
+ *
+ * Every MMIO and CSR access goes through the macros at the bottom of
+ * this file.  On the target they are plain volatile pointer accesses and
+ * inline csr instructions.  When CLIC_HOST_MODEL is defined (see the
+ * "host" target in the Makefile) they are routed to the register model
+ * in host/clic_model.c instead, so the same sources run on Linux.
+ */
+
+#ifndef CLIC_HAL_H
+#define CLIC_HAL_H
+
+#include <stdint.h>
+
+#include <metal/machine.h>
+#include <metal/machine/platform.h>
+#include <metal/machine/inline.h>
+
+#ifndef CLIC_HOST_MODEL
+#define CLIC_HOST_MODEL                 0
+#endif
+
+/* Define to 1 to run interrupt handlers on a dedicated stack, see clic_istack.h */
+#ifndef CLIC_ISTACK
+#define CLIC_ISTACK                     0
+#endif
+
+/* Define to 1 to paint the stacks and track high-water marks, see clic_stack.h */
+#ifndef CLIC_STACK_WATCH
+#define CLIC_STACK_WATCH                0
+#endif
+
+/* Define to 1 to count calls and cycles per interrupt ID, see clic_stats.h */
+#ifndef CLIC_STATS
+#define CLIC_STATS                      0
+#endif
+
+/* Define to 1 (with CLIC_STATS) for per-line latency histograms, see clic_hist.h */
+#ifndef CLIC_HIST
+#define CLIC_HIST                       0
+#endif
+
+/* Define to 1 to log interrupt enter/exit/pend records, see clic_trace.h */
+#ifndef CLIC_TRACE
+#define CLIC_TRACE                      0
+#endif
+
+/* Define to 1 for the timer driven sampling profiler, see clic_prof.h */
+#ifndef CLIC_PROF
+#define CLIC_PROF                       0
+#endif
+
+/* cliccfg.NLBITS main() configures.  With 1 the levels are 127 and 255, so
+ * the deferred work on #12 (level 0 in CLIC_IRQ_MAP, which encodes as 127)
+ * is preempted by every level 255 line.  0 puts all lines on level 255. */
+#ifndef CLIC_NLBITS
+#define CLIC_NLBITS                     1
+#endif
+
+#define DISABLE                 0
+#define ENABLE                  1
+#define TRUE                    1
+#define FALSE                   0
+#define INPUT                   0x100    /* something other than 0 or 1 */
+#define OUTPUT                  0x101    /* something other than 0 or 1 */
+#define RTC_FREQ                32768
+
+#define MCAUSE_INTR                         0x80000000UL
+#define MCAUSE_CAUSE                        0x000003FFUL
+#define MCAUSE_CODE(cause)                  (cause & MCAUSE_CAUSE)
+
+/* mintstatus (CSR 0x346).mil, the level the hart is running at */
+#define MINTSTATUS_MIL(val)                 (((val) >> 24) & 0xFF)
+
+/* mcause.mpil, the level the trap interrupted */
+#define MCAUSE_MPIL(cause)                  (((cause) >> 16) & 0xFF)
+
+/* Compile time options to determine which interrupt modules we have */
+#define CLIC_PRESENT                            (METAL_MAX_CLIC_INTERRUPTS > 0)
+#define PLIC_PRESENT                            (METAL_MAX_PLIC_INTERRUPTS > 0)
+
+/* Interrupt Specific defines - used for mtvec.mode field, which is bit[0] for
+ * designs with CLINT, or [1:0] for designs with a CLIC */
+#define MTVEC_MODE_CLINT_DIRECT                 0x00
+#define MTVEC_MODE_CLINT_VECTORED               0x01
+#define MTVEC_MODE_CLIC_DIRECT                  0x02
+#define MTVEC_MODE_CLIC_VECTORED                0x03
+
+/* Offsets for multi-core systems */
+#define MSIP_PER_HART_OFFSET                             0x4
+#define MTIMECMP_PER_HART_OFFSET                         0x8
+
+/* Every hart has its own clicintip/clicintie/clicintctl/cliccfg page, hart
+ * N's at HART0_CLIC_BASE_ADDR + N * CLIC_PER_HART_OFFSET.  Define it to 0
+ * for designs that alias each hart's page at the hart 0 address. */
+#ifndef CLIC_PER_HART_OFFSET
+#define CLIC_PER_HART_OFFSET                             0x1000
+#endif
+
+#define CLIC_NUM_HARTS                                  __METAL_DT_MAX_HARTS
+
+/* The hart running the code, a constant on single hart designs so that
+ * the per-hart addresses below fold to the hart 0 ones.  On multi-hart
+ * designs it comes from the hart's context block (clic_ctx.h), so it is
+ * only valid after clic_ctx_init(). */
+#if CLIC_NUM_HARTS > 1
+#define current_hartid()                                (clic_ctx()->hartid)
+#define current_clic_base()                             (clic_ctx()->clic)
+#else
+#define current_hartid()                                ((uintptr_t)0)
+#define current_clic_base()                             HART_CLIC_BASE_ADDR(0)
+#endif
+
+#if CLIC_PRESENT
+#define CLIC_BASE_ADDR                                  METAL_SIFIVE_CLIC0_0_BASE_ADDRESS
+#define MSIP_BASE_ADDR(hartid)                          (CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_MSIP_BASE + ((hartid) * MSIP_PER_HART_OFFSET))
+#define MTIMECMP_BASE_ADDR(hartid)                      (CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_MTIMECMP_BASE + ((hartid) * MTIMECMP_PER_HART_OFFSET))
+#define MTIME_BASE_ADDR                                 (CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_MTIME)
+#define HART0_CLIC_OFFSET                               0x00800000
+#define HART_CLIC_BASE_ADDR(hartid)                     (CLIC_BASE_ADDR + HART0_CLIC_OFFSET + ((hartid) * CLIC_PER_HART_OFFSET))
+#define HART_CLICINTIP_ADDR(hartid, int_num)            (HART_CLIC_BASE_ADDR(hartid) + METAL_SIFIVE_CLIC0_CLICINTIP_BASE + (int_num))   /* one byte per enable */
+#define HART_CLICINTIE_ADDR(hartid, int_num)            (HART_CLIC_BASE_ADDR(hartid) + METAL_SIFIVE_CLIC0_CLICINTIE_BASE + (int_num))   /* one byte per enable */
+#define HART_CLICINTCFG_ADDR(hartid, int_num)           (HART_CLIC_BASE_ADDR(hartid) + METAL_SIFIVE_CLIC0_CLICINTCTL_BASE + (int_num))   /* one byte per enable */
+#define HART_CLICCFG_ADDR(hartid)                       (HART_CLIC_BASE_ADDR(hartid) + METAL_SIFIVE_CLIC0_CLICCFG)   /* one byte per CLIC */
+#define HART0_CLIC_BASE_ADDR                            HART_CLIC_BASE_ADDR(0)
+#define HART0_CLICINTIP_ADDR(int_num)                   HART_CLICINTIP_ADDR(0, int_num)
+#define HART0_CLICINTIE_ADDR(int_num)                   HART_CLICINTIE_ADDR(0, int_num)
+#define HART0_CLICINTCFG_ADDR(int_num)                  HART_CLICINTCFG_ADDR(0, int_num)
+#define HART0_CLICCFG_ADDR                              HART_CLICCFG_ADDR(0)
+/* Same, for the hart running the code */
+#define CLICINTIP_ADDR(int_num)                         (current_clic_base() + METAL_SIFIVE_CLIC0_CLICINTIP_BASE + (int_num))
+#define CLICINTIE_ADDR(int_num)                         (current_clic_base() + METAL_SIFIVE_CLIC0_CLICINTIE_BASE + (int_num))
+#define CLICINTCFG_ADDR(int_num)                        (current_clic_base() + METAL_SIFIVE_CLIC0_CLICINTCTL_BASE + (int_num))
+#define CLICCFG_ADDR                                    (current_clic_base() + METAL_SIFIVE_CLIC0_CLICCFG)
+#define CLICCFG_NVBITS(x)                               ((x & 1) << 0)
+#define CLICCFG_NLBITS(x)                               ((x & 0xF) << 1)
+#define CLICCFG_NMBITS(x)                               ((x & 0x3) << 5)
+#define INT_ID_SOFTWARE                                 3
+#define INT_ID_TIMER                                    7
+#define INT_ID_EXTERNAL                                 11
+#define INT_ID_CLIC_SOFTWARE                            12
+#define MAX_LOCAL_INTS                                  16  /* local interrupts, not local external interrupts */
+#define CLIC_VECTOR_TABLE_SIZE_MAX                      METAL_SIFIVE_CLIC0_2000000_SIFIVE_NUMINTS
+#define SOFTWARE_INT_ENABLE                             write_byte(CLICINTIE_ADDR(INT_ID_SOFTWARE), ENABLE);
+#define SOFTWARE_INT_DISABLE                            write_byte(CLICINTIE_ADDR(INT_ID_SOFTWARE), DISABLE);
+#define TIMER_INT_ENABLE                                write_byte(CLICINTIE_ADDR(INT_ID_TIMER), ENABLE);
+#define TIMER_INT_DISABLE                               write_byte(CLICINTIE_ADDR(INT_ID_TIMER), DISABLE);
+#define EXTERNAL_INT_ENABLE                             write_byte(CLICINTIE_ADDR(INT_ID_EXTERNAL), ENABLE);
+#define EXTERNAL_INT_EDISABLE                           write_byte(CLICINTIE_ADDR(INT_ID_EXTERNAL), DISABLE);
+#define CLIC_SOFTWARE_INT_ENABLE                        write_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), ENABLE);
+#define CLIC_SOFTWARE_INT_DISABLE                       write_byte(CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), DISABLE);
+#define CLIC_SOFTWARE_INT_SET                           write_byte(CLICINTIP_ADDR(INT_ID_CLIC_SOFTWARE), ENABLE);
+#define CLIC_SOFTWARE_INT_CLEAR                         write_byte(CLICINTIP_ADDR(INT_ID_CLIC_SOFTWARE), DISABLE);
+#else
+#error "This design does not have a CLIC...Exiting.\n");
+#endif
+
+
+#include "clic_time.h"
+
+#define NUM_TICKS_ONE_S                         RTC_FREQ            // it takes this many ticks of mtime for 1s to elapse
+#define NUM_TICKS_ONE_MS                        (RTC_FREQ/1000)     // truncated (32 for 32768), use clic_ms_to_ticks() for intervals
+#define SET_TIMER_INTERVAL_MS(ms_ticks)         write_mtimecmp(clic_ctx()->mtimecmp, (read_mtime() + clic_ms_to_ticks(ms_ticks)))
+
+#if CLIC_HOST_MODEL
+
+#include "clic_model.h"
+
+/* Handler flavours - plain functions on the host, the model does the
+ * trap entry/exit bookkeeping around the call */
+#define CLIC_PREEMPTIBLE                        noinline
+#define CLIC_INTERRUPT                          noinline
+
+/* Defines to access CSR registers within C code, register names (or the raw
+ * CSR numbers used below, e.g. 0x307) map onto CLIC_CSR_* in clic_model.h */
+#define read_csr(reg)                           clic_model_csr_read(CLIC_CSR_##reg)
+#define write_csr(reg, val)                     clic_model_csr_write(CLIC_CSR_##reg, (uintptr_t)(val))
+#define set_csr(reg, bits)                      clic_model_csr_set(CLIC_CSR_##reg, (uintptr_t)(bits))
+#define clear_csr(reg, bits)                    clic_model_csr_clear(CLIC_CSR_##reg, (uintptr_t)(bits))
+
+#define write_dword(addr, data)                 clic_model_mmio_write((uintptr_t)(addr), (uint64_t)(data), 8)
+#define read_dword(addr)                        ((uint64_t)clic_model_mmio_read((uintptr_t)(addr), 8))
+#define write_word(addr, data)                  clic_model_mmio_write((uintptr_t)(addr), (uint64_t)(data), 4)
+#define read_word(addr)                         ((uint32_t)clic_model_mmio_read((uintptr_t)(addr), 4))
+#define write_byte(addr, data)                  clic_model_mmio_write((uintptr_t)(addr), (uint64_t)(data), 1)
+#define read_byte(addr)                         ((uint8_t)clic_model_mmio_read((uintptr_t)(addr), 1))
+
+#define wait_for_interrupt()                    clic_model_wfi()
+#define read_tp()                               clic_model_tp
+#define write_tp(val)                           (clic_model_tp = (uintptr_t)(val))
+#define read_sp()                               ((uintptr_t)__builtin_frame_address(0))
+#define read_ra()                               ((uintptr_t)__builtin_return_address(0))
+#define fence_i()
+/* Ordering between two access classes, e.g. memory_fence(w, w).  Sequentially
+ * consistent, memory_fence(rw, rw) is used for store->load ordering */
+#define memory_fence(pred, succ)                __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#else /* !CLIC_HOST_MODEL */
+
+#define CLIC_PREEMPTIBLE                        interrupt("SiFive-CLIC-preemptible")
+#define CLIC_INTERRUPT                          interrupt
+
+/* Defines to access CSR registers within C code */
+#define read_csr(reg) ({ unsigned long __tmp; \
+  asm volatile ("csrr %0, " #reg : "=r"(__tmp)); \
+  __tmp; })
+
+#define write_csr(reg, val) ({ \
+  asm volatile ("csrw " #reg ", %0" :: "rK"(val)); })
+
+#define set_csr(reg, bits) ({ unsigned long __tmp; \
+  asm volatile ("csrrs %0, " #reg ", %1" : "=r"(__tmp) : "rK"(bits)); \
+  __tmp; })
+
+#define clear_csr(reg, bits) ({ unsigned long __tmp; \
+  asm volatile ("csrrc %0, " #reg ", %1" : "=r"(__tmp) : "rK"(bits)); \
+  __tmp; })
+
+#define write_dword(addr, data)                 ((*(volatile uint64_t *)(addr)) = data)
+#define read_dword(addr)                        (*(volatile uint64_t *)(addr))
+#define write_word(addr, data)                  ((*(volatile uint32_t *)(addr)) = data)
+#define read_word(addr)                         (*(volatile uint32_t *)(addr))
+#define write_byte(addr, data)                  ((*(volatile uint8_t *)(addr)) = data)
+#define read_byte(addr)                         (*(volatile uint8_t *)(addr))
+
+#define wait_for_interrupt()                    asm volatile ("wfi")
+
+/* tp only changes in write_tp(), reads may be combined */
+#define read_tp() ({ uintptr_t __tmp; \
+  asm ("mv %0, tp" : "=r"(__tmp)); \
+  __tmp; })
+
+#define write_tp(val) ({ \
+  asm volatile ("mv tp, %0" :: "r"(val) : "memory"); })
+
+#define read_sp() ({ uintptr_t __tmp; \
+  asm volatile ("mv %0, sp" : "=r"(__tmp)); \
+  __tmp; })
+
+#define read_ra() ({ uintptr_t __tmp; \
+  asm volatile ("mv %0, ra" : "=r"(__tmp)); \
+  __tmp; })
+#define fence_i()                               asm volatile ("fence.i" ::: "memory")
+#define memory_fence(pred, succ)                asm volatile ("fence " #pred "," #succ ::: "memory")
+
+#endif /* CLIC_HOST_MODEL */
+
+/* Flavour of the handlers listed in IRQ maps: an interrupt handler, or
+ * with CLIC_ISTACK a plain function entered through its stub */
+#if CLIC_ISTACK
+#define CLIC_HANDLER                            noinline
+#else
+#define CLIC_HANDLER                            CLIC_PREEMPTIBLE
+#endif
+
+static inline __attribute__((always_inline)) void interrupt_global_enable (void) {
+    set_csr(mstatus, METAL_MIE_INTERRUPT);
+}
+
+static inline __attribute__((always_inline)) void interrupt_global_disable (void) {
+    clear_csr(mstatus, METAL_MIE_INTERRUPT);
+}
+
+/* mtime and mtimecmp are 64-bit registers, which RV32 can only reach 32 bits
+ * at a time (a volatile uint64_t access is split in an unspecified order).
+ * A split read can pair the low word from before a carry with the high word
+ * from after it, and a split write can leave mtimecmp briefly at a value
+ * below both the old and the new deadline, i.e. raise an early interrupt.
+ * read_mtime()/write_mtimecmp() use the split sequences when
+ * CLIC_MTIME_SPLIT is set (the default on RV32) and one 64-bit access
+ * otherwise.  The _split variants are always available for comparison. */
+#ifndef CLIC_MTIME_SPLIT
+#if defined(__riscv_xlen) && __riscv_xlen == 32
+#define CLIC_MTIME_SPLIT                        1
+#else
+#define CLIC_MTIME_SPLIT                        0
+#endif
+#endif
+
+/* hi/lo/hi: retry if the low word wrapped between the two high reads */
+static inline __attribute__((always_inline)) uint64_t read_mtime_split (void) {
+
+    uint32_t hi, lo;
+
+    do {
+        hi = read_word(MTIME_BASE_ADDR + 4);
+        lo = read_word(MTIME_BASE_ADDR);
+    } while (hi != read_word(MTIME_BASE_ADDR + 4));
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Low word to all ones first, so the intermediate value is never below the
+ * old or the new deadline.  Concurrent writers must be serialised. */
+static inline __attribute__((always_inline)) void write_mtimecmp_split (uintptr_t mtimecmp, uint64_t when) {
+
+    write_word(mtimecmp, 0xFFFFFFFF);
+    write_word(mtimecmp + 4, (uint32_t)(when >> 32));
+    write_word(mtimecmp, (uint32_t)when);
+}
+
+static inline __attribute__((always_inline)) uint64_t read_mtime (void) {
+
+#if CLIC_MTIME_SPLIT
+    return read_mtime_split();
+#else
+    return read_dword(MTIME_BASE_ADDR);
+#endif
+}
+
+/* mtimecmp is MTIMECMP_BASE_ADDR(hartid) */
+static inline __attribute__((always_inline)) void write_mtimecmp (uintptr_t mtimecmp, uint64_t when) {
+
+#if CLIC_MTIME_SPLIT
+    write_mtimecmp_split(mtimecmp, when);
+#else
+    write_dword(mtimecmp, when);
+#endif
+}
+
+/* Needs everything above */
+#include "clic_ctx.h"
+
+#endif /* CLIC_HAL_H */
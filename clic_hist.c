@@ -0,0 +1,81 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <stdio.h>
+
+#include "clic_hist.h"
+#include "clic_crit.h"
+
+#if CLIC_HIST
+
+clic_hist_line_t clic_hist[CLIC_NUM_HARTS][CLIC_HIST_LINES];
+uint32_t clic_hist_trigger[CLIC_NUM_HARTS][CLIC_HIST_LINES];
+
+int clic_hist_snapshot(unsigned int_id, clic_hist_line_t *snapshot) {
+
+    unsigned line = int_id - CLIC_HIST_FIRST, b;
+    clic_hist_line_t *hist;
+    clic_crit_t crit;
+
+    if (line >= CLIC_HIST_LINES)
+        return -1;
+    hist = &clic_hist[current_hartid()][line];
+
+    /* 64 words, short enough to hold interrupts off for */
+    crit = clic_crit_enter(CLIC_CRIT_ALL);
+    for (b = 0; b < CLIC_HIST_BUCKETS; b++) {
+        snapshot->latency[b] = hist->latency[b];
+        snapshot->duration[b] = hist->duration[b];
+        hist->latency[b] = 0;
+        hist->duration[b] = 0;
+    }
+    clic_crit_exit(crit);
+    return 0;
+}
+
+uint32_t clic_hist_percentile(const uint32_t *buckets, unsigned permille) {
+
+    uint64_t total = 0, rank, seen = 0;
+    unsigned b;
+
+    for (b = 0; b < CLIC_HIST_BUCKETS; b++)
+        total += buckets[b];
+    if (!total)
+        return 0;
+
+    /* Smallest bucket covering ceil(total * permille / 1000) samples */
+    rank = (total * permille + 999) / 1000;
+    for (b = 0; b < CLIC_HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank)
+            break;
+    }
+    return b < CLIC_HIST_BUCKETS - 1 ? (2u << b) - 1 : UINT32_MAX;
+}
+
+void clic_hist_print_header(void) {
+
+    printf("hist,id,metric,samples,p50,p90,p99,p99.9\n");
+}
+
+static void print_row(unsigned int_id, const char *metric, const uint32_t *buckets) {
+
+    uint64_t total = 0;
+    unsigned b;
+
+    for (b = 0; b < CLIC_HIST_BUCKETS; b++)
+        total += buckets[b];
+    printf("hist,%u,%s,%llu,%lu,%lu,%lu,%lu\n", int_id, metric, (unsigned long long)total,
+           (unsigned long)clic_hist_percentile(buckets, 500),
+           (unsigned long)clic_hist_percentile(buckets, 900),
+           (unsigned long)clic_hist_percentile(buckets, 990),
+           (unsigned long)clic_hist_percentile(buckets, 999));
+}
+
+void clic_hist_print(unsigned int_id, const clic_hist_line_t *snapshot) {
+
+    print_row(int_id, "latency", snapshot->latency);
+    print_row(int_id, "duration", snapshot->duration);
+}
+
+#endif
@@ -0,0 +1,110 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Log2 latency histograms per interrupt line, built with CLIC_HIST=1 on
+ * top of CLIC_STATS=1.
+ *
+ * For IDs CLIC_HIST_FIRST.. (the local external lines by default) the
+ * statistics hooks count each invocation in two histograms:
+ *
+ *   latency    trigger -> CLIC_STATS_ENTRY(), when the trigger was stamped
+ *   duration   CLIC_STATS_ENTRY() -> CLIC_STATS_EXIT(), preemptions included
+ *
+ * Bucket b counts deltas of [2^b, 2^(b+1)) cycles (bucket 0 also holds 0),
+ * found with one clz, so an update is a few instructions and takes no
+ * branch; cores without Zbb get clz from libgcc.
+ *
+ * The same hooks then also keep the max and preempted counters of
+ * clic_stats.h, which the plain CLIC_STATS hooks leave out.
+ *
+ * The CLIC cannot tell when a line went pending, so latency needs a
+ * stamp: CLIC_HIST_PEND() stamps and pends a line from software, and a
+ * driver that knows when its device raised the line calls
+ * clic_hist_stamp().  Unstamped invocations add 0 to the latency bucket.
+ *
+ * clic_hist_snapshot() copies and clears one line with interrupts off, so
+ * no handler of that line can update it half way; clic_hist_print() turns
+ * a snapshot into p50/p90/p99/p99.9 upper bounds.
+ */
+
+#ifndef CLIC_HIST_H
+#define CLIC_HIST_H
+
+#include "clic_hal.h"
+
+#if CLIC_HIST && !CLIC_STATS
+#error "CLIC_HIST counts from the CLIC_STATS hooks, build with CLIC_STATS=1"
+#endif
+
+/* IDs with histograms, 32 buckets each for latency and duration */
+#ifndef CLIC_HIST_FIRST
+#define CLIC_HIST_FIRST                         MAX_LOCAL_INTS
+#endif
+#ifndef CLIC_HIST_LINES
+#define CLIC_HIST_LINES                         (CLIC_VECTOR_TABLE_SIZE_MAX - CLIC_HIST_FIRST)
+#endif
+
+#define CLIC_HIST_BUCKETS                       32
+
+typedef struct clic_hist_line {
+    uint32_t latency[CLIC_HIST_BUCKETS];
+    uint32_t duration[CLIC_HIST_BUCKETS];
+} clic_hist_line_t;
+
+extern clic_hist_line_t clic_hist[CLIC_NUM_HARTS][CLIC_HIST_LINES];
+extern uint32_t clic_hist_trigger[CLIC_NUM_HARTS][CLIC_HIST_LINES];
+
+static inline __attribute__((always_inline)) unsigned clic_hist_bucket (uint32_t cycles) {
+
+    return 31 - __builtin_clz(cycles | 1);
+}
+
+/* mcycle stamp of the moment int_id was triggered, 0 means none */
+static inline __attribute__((always_inline)) void clic_hist_stamp (unsigned int_id) {
+
+    unsigned line = int_id - CLIC_HIST_FIRST;
+
+    if (line < CLIC_HIST_LINES)
+        clic_hist_trigger[current_hartid()][line] = (uint32_t)read_csr(mcycle) | 1;
+}
+
+#define CLIC_HIST_PEND(int_id)                  do { clic_hist_stamp(int_id);                      \
+                                                     write_byte(CLICINTIP_ADDR(int_id), ENABLE); } while (0)
+
+/* From clic_stats_enter()/clic_stats_leave() */
+static inline __attribute__((always_inline)) void clic_hist_enter (unsigned int_id, uint32_t now) {
+
+    unsigned line = int_id - CLIC_HIST_FIRST;
+    uint32_t *trigger, stamp;
+
+    if (line < CLIC_HIST_LINES) {
+        trigger = &clic_hist_trigger[current_hartid()][line];
+        stamp = *trigger;
+        clic_hist[current_hartid()][line].latency[clic_hist_bucket(now - stamp)] += stamp != 0;
+        *trigger = 0;
+    }
+}
+
+static inline __attribute__((always_inline)) void clic_hist_leave (unsigned int_id, uint32_t elapsed) {
+
+    unsigned line = int_id - CLIC_HIST_FIRST;
+
+    if (line < CLIC_HIST_LINES)
+        clic_hist[current_hartid()][line].duration[clic_hist_bucket(elapsed)]++;
+}
+
+/* Copy int_id's histograms of the calling hart into snapshot and clear
+ * them.  Returns 0, or -1 for an ID without histograms. */
+int clic_hist_snapshot(unsigned int_id, clic_hist_line_t *snapshot);
+
+/* Upper bound in cycles of the bucket holding the permille-th percentile,
+ * 0 for an empty histogram */
+uint32_t clic_hist_percentile(const uint32_t *buckets, unsigned permille);
+
+/* CSV export: clic_hist_print_header() once, then
+ * "hist,<id>,latency|duration,<samples>,<p50>,<p90>,<p99>,<p99.9>" rows */
+void clic_hist_print_header(void);
+void clic_hist_print(unsigned int_id, const clic_hist_line_t *snapshot);
+
+#endif /* CLIC_HIST_H */
@@ -0,0 +1,137 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_irq.h"
+
+#define NUMINTS                 METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS
+
+/* clicintctl bits below NUMINTBITS are not implemented and read as one */
+#define CLICINTCTL_IMPL_MASK    ((uint8_t)(0xFF << (8 - METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS)))
+
+/* One group of four consecutive IDs, i.e. one 32-bit word of each array */
+struct irq_batch {
+    uintptr_t hartid;
+    uint32_t group;
+    uint32_t present;       /* byte lanes configured by the table */
+    uint32_t edge;          /* byte lanes of edge triggered lines */
+    uint32_t ctl;
+    uint32_t ie;
+};
+
+/* Level in the top NLBITS, priority in the implemented bits below it */
+static uint8_t clic_irq_encode(const clic_irq_t *irq, unsigned nlbits, unsigned nvbits) {
+
+    uint8_t lmask = (uint8_t)(0xFF00 >> nlbits);
+    uint8_t ctl;
+
+    ctl = (irq->level & lmask) | ((irq->priority >> nlbits) & (uint8_t)~lmask);
+    ctl |= (uint8_t)~CLICINTCTL_IMPL_MASK;
+    if (nvbits)
+        ctl = (ctl & 0xFE) | (irq->shv & 1);
+    return ctl;
+}
+
+static void clic_irq_merge_word(uintptr_t addr, uint32_t present, uint32_t val) {
+
+    if (present != 0xFFFFFFFF)
+        val = (read_word(addr) & ~present) | (val & present);
+    write_word(addr, val);
+}
+
+static void clic_irq_flush(const struct irq_batch *b) {
+
+    uint32_t first = b->group * 4;
+    unsigned lane;
+
+    if (!b->present)
+        return;
+
+    /* The last group may be partial, never touch bytes past the CLIC */
+    if (first + 4 > NUMINTS) {
+        for (lane = 0; lane < 4; lane++) {
+            if (!(b->present & (0xFFu << (8 * lane))))
+                continue;
+            write_byte(HART_CLICINTCFG_ADDR(b->hartid, first + lane), (uint8_t)(b->ctl >> (8 * lane)));
+            if (b->edge & (0xFFu << (8 * lane)))
+                write_byte(HART_CLICINTIP_ADDR(b->hartid, first + lane), DISABLE);
+            write_byte(HART_CLICINTIE_ADDR(b->hartid, first + lane), (uint8_t)(b->ie >> (8 * lane)));
+        }
+        return;
+    }
+
+    clic_irq_merge_word(HART_CLICINTCFG_ADDR(b->hartid, first), b->present, b->ctl);
+
+    /* clicintip is written a byte at a time, a read-modify-write of the word
+     * could lose an edge latched on a neighbouring line in between */
+    for (lane = 0; lane < 4; lane++)
+        if (b->edge & (0xFFu << (8 * lane)))
+            write_byte(HART_CLICINTIP_ADDR(b->hartid, first + lane), DISABLE);
+
+    clic_irq_merge_word(HART_CLICINTIE_ADDR(b->hartid, first), b->present, b->ie);
+}
+
+uint32_t clic_irq_register(const clic_irq_t *irqs, unsigned count) {
+
+    uint32_t start = (uint32_t)read_csr(mcycle);
+    uintptr_t hartid = current_hartid();
+    uint8_t cliccfg = read_byte(HART_CLICCFG_ADDR(hartid));
+    unsigned nlbits = (cliccfg >> 1) & 0xF;
+    unsigned nvbits = cliccfg & 1;
+    struct irq_batch b = { .hartid = hartid };
+#if CLIC_VECTOR_TABLE_IN_RAM
+    uintptr_t *mtvt = (uintptr_t *)read_csr(0x307);
+#endif
+    uint32_t lane;
+    unsigned i;
+
+    if (nlbits > 8)
+        nlbits = 8;
+
+    for (i = 0; i < count; i++) {
+        const clic_irq_t *irq = &irqs[i];
+
+        if (irq->int_id >= NUMINTS)
+            continue;
+
+        if (irq->int_id / 4 != b.group) {
+            clic_irq_flush(&b);
+            b = (struct irq_batch){ .hartid = hartid, .group = irq->int_id / 4 };
+        }
+
+        lane = 8 * (irq->int_id % 4);
+        b.present |= 0xFFu << lane;
+        b.ctl = (b.ctl & ~(0xFFu << lane)) | ((uint32_t)clic_irq_encode(irq, nlbits, nvbits) << lane);
+        b.ie |= (uint32_t)ENABLE << lane;
+        if (irq->trigger == CLIC_TRIGGER_EDGE)
+            b.edge |= 0xFFu << lane;
+
+#if CLIC_VECTOR_TABLE_IN_RAM
+        mtvt[irq->int_id] = (uintptr_t)irq->handler;
+#endif
+    }
+    clic_irq_flush(&b);
+
+#if CLIC_VECTOR_TABLE_IN_RAM
+    fence_i();
+#endif
+
+    return (uint32_t)read_csr(mcycle) - start;
+}
+
+uint32_t clic_hart_init(const clic_hart_t *hart) {
+
+    /* Nothing may be taken half way through, the caller enables mstatus.mie */
+    interrupt_global_disable();
+
+    write_csr(mtvec, hart->mtvec | MTVEC_MODE_CLIC_VECTORED);
+    write_csr(0x307, (uintptr_t)hart->mtvt);    /* 0x307 is CLIC CSR number */
+    write_byte(CLICCFG_ADDR, hart->cliccfg);
+#if CLIC_ISTACK
+    clic_istack_init();
+#endif
+#if CLIC_STACK_WATCH
+    clic_stack_init();
+#endif
+
+    return clic_irq_register(hart->irqs, hart->count);
+}
@@ -0,0 +1,137 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Table driven CLIC interrupt registration.
+ *
+ * An application describes its interrupts once, as an X-macro map with one
+ * IRQ(int_id, level, priority, shv, trigger, handler) line per interrupt:
+ *
+ *   #define APP_IRQ_MAP(IRQ) \
+ *       IRQ(16, 255, 255, 1, CLIC_TRIGGER_LEVEL, lc0_handler) \
+ *       IRQ(17, 127, 255, 1, CLIC_TRIGGER_EDGE,  lc1_handler)
+ *
+ *   CLIC_DEFINE_VECTOR_TABLE(APP_IRQ_MAP);
+ *   static const clic_irq_t app_irqs[] = { APP_IRQ_MAP(CLIC_IRQ_ENTRY) };
+ *   ...
+ *   clic_irq_register(app_irqs, sizeof(app_irqs) / sizeof(app_irqs[0]));
+ *
+ * The same map produces the build time vector table and the configuration
+ * table, and clic_irq_register() brings the whole table up in one call.
+ *
+ * On multi-hart designs every hart has its own CLIC page and mtvt, and
+ * brings itself up with clic_hart_init() from its own entry point:
+ *
+ *   CLIC_DEFINE_HART_VECTOR_TABLE(hart1_mtvt, HART1_IRQ_MAP);
+ *   static const clic_irq_t hart1_irqs[] = { HART1_IRQ_MAP(CLIC_IRQ_ENTRY) };
+ *   static const clic_hart_t hart1 = {
+ *       (uintptr_t)&default_exception_handler, hart1_mtvt,
+ *       CLICCFG_NLBITS(0), hart1_irqs, sizeof(hart1_irqs) / sizeof(hart1_irqs[0])
+ *   };
+ *   ...
+ *   clic_hart_init(&hart1);
+ *   interrupt_global_enable();
+ */
+
+#ifndef CLIC_IRQ_H
+#define CLIC_IRQ_H
+
+#include "clic_hal.h"
+#include "clic_istack.h"
+#include "clic_stack.h"
+
+/* Trigger type of a line.  The SiFive CLIC has no clicintattr register,
+ * the trigger is fixed by the hardware; it is recorded here so that edge
+ * triggered lines get a stale pending edge dropped before being enabled. */
+#define CLIC_TRIGGER_LEVEL                      0
+#define CLIC_TRIGGER_EDGE                       1
+
+typedef struct {
+    uint16_t int_id;
+    uint8_t level;          /* 0-255, top cliccfg.NLBITS bits are used */
+    uint8_t priority;       /* 0-255, top (NUMINTBITS - NLBITS) bits are used */
+    uint8_t shv;            /* selective hardware vectoring, used when cliccfg.NVBITS = 1 */
+    uint8_t trigger;        /* CLIC_TRIGGER_LEVEL or CLIC_TRIGGER_EDGE */
+    void (*handler)(void);
+} clic_irq_t;
+
+#define CLIC_IRQ_ENTRY(int_id, level, priority, shv, trigger, handler) \
+    { (int_id), (level), (priority), (shv), (trigger), &CLIC_VECTOR_TARGET(handler) },
+
+#define CLIC_VECTOR_ENTRY(int_id, level, priority, shv, trigger, handler) \
+    [int_id] = (uintptr_t)&CLIC_VECTOR_TARGET(handler),
+
+/* Define to 1 to keep the vector table in RAM, needed only to re-vector
+ * interrupts at runtime with CLIC_SET_VECTOR() */
+#ifndef CLIC_VECTOR_TABLE_IN_RAM
+#define CLIC_VECTOR_TABLE_IN_RAM                0
+#endif
+
+/* The vector table is resolved at build time from the IRQ map.  By default
+ * it is const and lands in ROM through the .rodata.* input sections of the
+ * BSP linker script; the RAM copy is a .data section that crt0 copies from
+ * ROM together with the rest of .data, so nothing is filled in at boot.
+ * IDs missing from the map vector to default_exception_handler. */
+#if CLIC_VECTOR_TABLE_IN_RAM
+#define CLIC_VECTOR_TABLE_QUALIFIER
+#define CLIC_VECTOR_TABLE_SECTION               ".data.mtvt"
+#else
+#define CLIC_VECTOR_TABLE_QUALIFIER             const
+#define CLIC_VECTOR_TABLE_SECTION               ".rodata.mtvt"
+#endif
+
+extern CLIC_VECTOR_TABLE_QUALIFIER uintptr_t __mtvt_clic_vector_table[CLIC_VECTOR_TABLE_SIZE_MAX];
+
+/* Every ID of a map as a case label, so an ID listed twice fails to build
+ * with "duplicate case value" instead of silently taking the last entry */
+#define CLIC_IRQ_CASE(int_id, level, priority, shv, trigger, handler) case (int_id):
+
+#define CLIC_IRQ_MAP_CHECK(name, map)                                                   \
+    static inline __attribute__((unused)) void name##_check_ids (unsigned id) {         \
+        switch (id) { map(CLIC_IRQ_CASE) break; }                                       \
+    }
+
+/* A vector table under any name, one per hart that needs its own handlers.
+ * With CLIC_ISTACK it also emits the entry stubs the table points at. */
+#define CLIC_DEFINE_HART_VECTOR_TABLE(name, map)                                        \
+    CLIC_IRQ_MAP_CHECK(name, map)                                                       \
+    CLIC_ISTACK_STUBS(map)                                                              \
+    __attribute__((section(CLIC_VECTOR_TABLE_SECTION "." #name), aligned(64)))         \
+    CLIC_VECTOR_TABLE_QUALIFIER uintptr_t name[CLIC_VECTOR_TABLE_SIZE_MAX] = {         \
+        [0 ... CLIC_VECTOR_TABLE_SIZE_MAX - 1] = (uintptr_t)&default_exception_handler, \
+        map(CLIC_VECTOR_ENTRY)                                                          \
+    }
+
+/* The boot hart's table */
+#define CLIC_DEFINE_VECTOR_TABLE(map)           CLIC_DEFINE_HART_VECTOR_TABLE(__mtvt_clic_vector_table, map)
+
+#if CLIC_VECTOR_TABLE_IN_RAM
+/* The table is fetched by the vectoring hardware, make the update visible */
+#define CLIC_SET_VECTOR(int_id, handler)        do { __mtvt_clic_vector_table[int_id] = (uintptr_t)&handler; \
+                                                     fence_i(); } while (0)
+#endif
+
+/* Configure clicintctl, drop stale edges, fill the vector (RAM table only)
+ * and set clicintie for every entry, on the calling hart's CLIC and in the
+ * table its mtvt points at.  Writes are batched into one 32-bit
+ * access per group of four consecutive IDs, so tables sorted by int_id
+ * need the fewest bus accesses.  Entries with an int_id outside the CLIC
+ * are skipped.  Returns the mcycle count the setup took. */
+uint32_t clic_irq_register(const clic_irq_t *irqs, unsigned count);
+
+/* Everything one hart needs to take interrupts in CLIC vectored mode */
+typedef struct {
+    uintptr_t mtvec;        /* mtvec.base: exceptions, and non-SHV interrupts with NVBITS = 1 */
+    CLIC_VECTOR_TABLE_QUALIFIER uintptr_t *mtvt;
+    uint8_t cliccfg;        /* see CLICCFG_NVBITS/NLBITS/NMBITS */
+    const clic_irq_t *irqs;
+    unsigned count;
+} clic_hart_t;
+
+/* Bring up the calling hart: mstatus.mie off, mtvec in CLIC vectored mode,
+ * mtvt, cliccfg, then clic_irq_register().  Must run on the hart itself,
+ * the CSRs are per hart.  mstatus.mie is left off.  Returns the mcycle
+ * count of the registration. */
+uint32_t clic_hart_init(const clic_hart_t *hart);
+
+#endif /* CLIC_IRQ_H */
@@ -0,0 +1,165 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Header only C++ counterpart of the HART_CLIC* macros and clic_irq.h.
+ *
+ * Every register address is a constant expression of the interrupt ID, so
+ * clic::Irq<16>::enable() is one byte store to a fixed address, and IDs
+ * outside the CLIC or levels the design cannot encode fail to compile
+ * instead of misbehaving on hardware:
+ *
+ *   using button0 = clic::Irq<16>;
+ *
+ *   button0::configure<127, 255>();    // level 127, priority 255
+ *   button0::enable();
+ *   ...
+ *   button0::clear();
+ *
+ * The clicintctl value built by configure() follows the same encoding as
+ * clic_irq_register(), for the cliccfg.NLBITS given as template argument
+ * (CLIC_NLBITS from clic_hal.h by default, what main() writes to cliccfg).
+ * A level is accepted the way the CLIC arbitrates it, with the bits below
+ * NLBITS set (127 or 255 with NLBITS = 1), or as its top NLBITS bits alone
+ * (0 or 128), which is how the IRQ maps write the lowest level; both give
+ * the same clicintctl.  Any other level fails to compile, where
+ * clic_irq_register() would silently drop its low bits.
+ *
+ * Lines of another hart's CLIC take the hart ID as second argument,
+ * e.g. clic::Irq<16, 1> is local_ext_irq0 of hart 1.
+ *
+ * Needs C++17 (if constexpr in clic::Irqs).
+ */
+
+#ifndef CLIC_IRQ_HPP
+#define CLIC_IRQ_HPP
+
+#include "clic_hal.h"
+
+namespace clic {
+
+constexpr unsigned numints = METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS;
+constexpr unsigned numintbits = METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS;
+constexpr unsigned nlbits = CLIC_NLBITS;
+
+static_assert(numintbits <= 8, "clicintctl is one byte");
+static_assert(nlbits <= 8, "NLBITS above 8 behaves as 8, say so explicitly");
+
+constexpr unsigned numharts = CLIC_NUM_HARTS;
+
+constexpr uintptr_t cliccfg_addr = HART0_CLICCFG_ADDR;
+
+template <unsigned Hart = 0>
+constexpr uintptr_t hart_cliccfg_addr() {
+    static_assert(Hart < numharts, "hart ID beyond __METAL_DT_MAX_HARTS");
+    return HART_CLICCFG_ADDR(Hart);
+}
+
+/* cliccfg value, see CLICCFG_NVBITS/NLBITS/NMBITS */
+template <unsigned NVBits, unsigned NLBits, unsigned NMBits = 0>
+constexpr uint8_t cliccfg() {
+    static_assert(NVBits <= 1, "NVBITS is one bit");
+    static_assert(NLBits <= 8, "NLBITS above 8 is not meaningful");
+    static_assert(NMBits == 0, "machine mode interrupts only");
+    return (uint8_t)(CLICCFG_NVBITS(NVBits) | CLICCFG_NLBITS(NLBits) | CLICCFG_NMBITS(NMBits));
+}
+
+/* clicintctl bits below NUMINTBITS are not implemented and read as one */
+constexpr uint8_t impl_mask = (uint8_t)(0xFF << (8 - numintbits));
+
+/* Level in the top NLBits, priority in the implemented bits below it */
+constexpr uint8_t encode(unsigned level, unsigned priority, unsigned nl, unsigned shv = 1, unsigned nv = 0) {
+    return (uint8_t)((((level & (uint8_t)(0xFF00 >> nl)) |
+                       ((priority >> nl) & (uint8_t)~(0xFF00 >> nl)) |
+                       (uint8_t)~impl_mask) & (nv ? 0xFE : 0xFF)) |
+                     (nv ? (shv & 1) : 0));
+}
+
+/* Level bits below the top NL, read as one by the CLIC */
+constexpr uint8_t level_fill(unsigned nl) {
+    return (uint8_t)~(0xFF00 >> nl);
+}
+
+/* Level the CLIC arbitrates with for a clicintctl value */
+constexpr uint8_t level_of(uint8_t ctl, unsigned nl) {
+    return (uint8_t)((ctl & (uint8_t)(0xFF00 >> nl)) | level_fill(nl));
+}
+
+/* Level as arbitrated, or as its top NL bits with the rest clear */
+constexpr bool level_ok(unsigned level, unsigned nl) {
+    return (level & level_fill(nl)) == 0 || (level & level_fill(nl)) == level_fill(nl);
+}
+
+template <unsigned Id, unsigned Hart = 0>
+struct Irq {
+    static_assert(Id < numints, "interrupt ID beyond METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS");
+    static_assert(Hart < numharts, "hart ID beyond __METAL_DT_MAX_HARTS");
+
+    static constexpr unsigned id = Id;
+    static constexpr unsigned hart = Hart;
+    static constexpr uintptr_t ip_addr = HART_CLICINTIP_ADDR(Hart, Id);
+    static constexpr uintptr_t ie_addr = HART_CLICINTIE_ADDR(Hart, Id);
+    static constexpr uintptr_t ctl_addr = HART_CLICINTCFG_ADDR(Hart, Id);
+
+    static inline __attribute__((always_inline)) void enable() { write_byte(ie_addr, ENABLE); }
+    static inline __attribute__((always_inline)) void disable() { write_byte(ie_addr, DISABLE); }
+    static inline __attribute__((always_inline)) bool enabled() { return read_byte(ie_addr) & 1; }
+
+    /* Software pend/clear, only for IDs whose clicintip is writable */
+    static inline __attribute__((always_inline)) void pend() {
+        static_assert(Id != INT_ID_SOFTWARE, "ID 3 is pended through MSIP");
+        static_assert(Id != INT_ID_TIMER, "ID 7 is pended through mtimecmp");
+        write_byte(ip_addr, ENABLE);
+    }
+    static inline __attribute__((always_inline)) void clear() {
+        static_assert(Id != INT_ID_SOFTWARE, "ID 3 is cleared through MSIP");
+        static_assert(Id != INT_ID_TIMER, "ID 7 is cleared through mtimecmp");
+        write_byte(ip_addr, DISABLE);
+    }
+    static inline __attribute__((always_inline)) bool pending() { return read_byte(ip_addr) & 1; }
+
+    /* Level and priority 0-255, the top NLBits of Level are the level */
+    template <unsigned Level, unsigned Priority = 255, unsigned NLBits = nlbits, unsigned Shv = 1, unsigned NVBits = 0>
+    static inline __attribute__((always_inline)) void configure() {
+        static_assert(Level <= 255 && Priority <= 255, "level and priority are 0-255");
+        static_assert(NLBits <= 8, "NLBITS above 8 is not meaningful");
+        static_assert(level_ok(Level, NLBits),
+                      "level cannot be encoded with this NLBITS, use one of the levels in main() "
+                      "or its top NLBITS bits");
+        constexpr uint8_t ctl = encode(Level, Priority, NLBits, Shv, NVBits);
+        write_byte(ctl_addr, ctl);
+    }
+};
+
+/* Range of IDs, for the local external lines e.g. clic::Irqs<16, 47>::enable() */
+template <unsigned First, unsigned Last, unsigned Hart = 0>
+struct Irqs {
+    static_assert(First <= Last, "empty range");
+    static_assert(Last < numints, "interrupt ID beyond METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS");
+
+    static inline __attribute__((always_inline)) void enable() {
+        Irq<First, Hart>::enable();
+        if constexpr (First < Last)
+            Irqs<First + 1, Last, Hart>::enable();
+    }
+    static inline __attribute__((always_inline)) void disable() {
+        Irq<First, Hart>::disable();
+        if constexpr (First < Last)
+            Irqs<First + 1, Last, Hart>::disable();
+    }
+    template <unsigned Level, unsigned Priority = 255, unsigned NLBits = nlbits>
+    static inline __attribute__((always_inline)) void configure() {
+        Irq<First, Hart>::template configure<Level, Priority, NLBits>();
+        if constexpr (First < Last)
+            Irqs<First + 1, Last, Hart>::template configure<Level, Priority, NLBits>();
+    }
+};
+
+using Software = Irq<INT_ID_SOFTWARE>;
+using Timer = Irq<INT_ID_TIMER>;
+using External = Irq<INT_ID_EXTERNAL>;
+using ClicSoftware = Irq<INT_ID_CLIC_SOFTWARE>;
+
+} /* namespace clic */
+
+#endif /* CLIC_IRQ_HPP */
@@ -0,0 +1,14 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_istack.h"
+
+#if CLIC_ISTACK
+
+void clic_istack_init(void) {
+
+    /* Full descending stack, the first push lands below the top */
+    write_csr(mscratch, (uintptr_t)&clic_istack[(current_hartid() + 1) * clic_istack_size]);
+}
+
+#endif
@@ -0,0 +1,191 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Dedicated interrupt stack, built with CLIC_ISTACK=1.
+ *
+ * By default a "SiFive-CLIC-preemptible" handler pushes its frame onto
+ * whatever stack was live when the interrupt came in, so every task stack
+ * (here the single __stack_size stack) must leave room for the deepest
+ * nesting of handler frames.  With CLIC_ISTACK every vector in the tables
+ * built by CLIC_DEFINE_HART_VECTOR_TABLE() points at a small entry stub
+ * instead, generated per handler, which
+ *
+ *   csrrw sp, mscratchcswl, sp     swaps to the interrupt stack, but only
+ *                                  when coming from level 0 (thread code)
+ *   saves the caller saved registers, mcause and mepc
+ *   re-enables interrupts and calls the handler, a plain C function
+ *   restores, swaps back when returning to level 0, and does mret
+ *
+ * mscratchcswl (CSR 0x349) swaps sp with mscratch only when the interrupt
+ * level changes between zero and non-zero, so nested interrupts keep
+ * pushing onto the interrupt stack and only the outermost one switches.
+ * clic_hart_init() points mscratch at the top of the calling hart's
+ * interrupt stack.
+ *
+ * The stack is sized at compile time from the IRQ maps:
+ *
+ *   CLIC_DEFINE_ISTACK(CLIC_NEST_DEPTH(CLIC_IRQ_MAP));
+ *
+ * An interrupt only preempts a lower level, so the number of distinct
+ * levels in the map bounds how deep handlers can nest.  Each level gets
+ * CLIC_ISTACK_FRAME bytes for the handler's own stack use on top of the
+ * stub frame, plus one more level for an exception taken in a handler.
+ *
+ * Handlers in the maps are declared CLIC_HANDLER, which is a plain
+ * function in this mode.  The mnxti dispatcher is not covered, and the
+ * stubs do not save FP registers.  On the host model the stubs and the
+ * stack swap are left out; only the sizing is built.
+ */
+
+#ifndef CLIC_ISTACK_H
+#define CLIC_ISTACK_H
+
+#include "clic_hal.h"
+
+/* Stack bytes one handler may use itself, on top of the stub frame */
+#ifndef CLIC_ISTACK_FRAME
+#define CLIC_ISTACK_FRAME                       256
+#endif
+
+#if CLIC_ISTACK && CLIC_NXTI_DISPATCH
+#error "CLIC_ISTACK does not cover the mnxti dispatcher"
+#endif
+
+#if CLIC_ISTACK && defined(__riscv_flen)
+#error "CLIC_ISTACK entry stubs do not save the FP registers"
+#endif
+
+/* Distinct levels in an IRQ map, as four 64-bit masks of the raw 0-255
+ * levels.  NLBITS can only merge levels, so this is an upper bound for any
+ * cliccfg; it is capped by the levels NUMINTBITS can encode at all. */
+#define CLIC_LEVEL_BIT(level, word)             (((level) >> 6) == (word) ? 1ULL << ((level) & 63) : 0)
+#define CLIC_LEVEL_BIT0(int_id, level, priority, shv, trigger, handler)  | CLIC_LEVEL_BIT(level, 0)
+#define CLIC_LEVEL_BIT1(int_id, level, priority, shv, trigger, handler)  | CLIC_LEVEL_BIT(level, 1)
+#define CLIC_LEVEL_BIT2(int_id, level, priority, shv, trigger, handler)  | CLIC_LEVEL_BIT(level, 2)
+#define CLIC_LEVEL_BIT3(int_id, level, priority, shv, trigger, handler)  | CLIC_LEVEL_BIT(level, 3)
+#define CLIC_MAP_LEVELS(map)                    (__builtin_popcountll(0 map(CLIC_LEVEL_BIT0)) + \
+                                                 __builtin_popcountll(0 map(CLIC_LEVEL_BIT1)) + \
+                                                 __builtin_popcountll(0 map(CLIC_LEVEL_BIT2)) + \
+                                                 __builtin_popcountll(0 map(CLIC_LEVEL_BIT3)))
+#define CLIC_NEST_DEPTH(map)                    (CLIC_MAP_LEVELS(map) < (1 << METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS) ? \
+                                                 CLIC_MAP_LEVELS(map) : (1 << METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS))
+#define CLIC_MAX(a, b)                          ((a) > (b) ? (a) : (b))
+
+/* Stub frame: ra, t0-t2, a0-a7, t3-t6 (a0-a5 only on RV32E), mcause, mepc */
+#if defined(__riscv_32e)
+#define CLIC_ISTACK_STUB_REGS                   12
+#else
+#define CLIC_ISTACK_STUB_REGS                   18
+#endif
+#define CLIC_ISTACK_STUB_FRAME                  ((CLIC_ISTACK_STUB_REGS * sizeof(uintptr_t) + 15) & ~15)
+
+/* Worst case interrupt stack for a nesting depth, one extra level for an
+ * exception, 16-byte aligned like the ABI stack */
+#define CLIC_ISTACK_SIZE(depth)                 ((((depth) + 1) * (CLIC_ISTACK_FRAME + CLIC_ISTACK_STUB_FRAME) + 15) & ~15)
+
+/* One interrupt stack per hart.  depth is the nesting bound, e.g.
+ * CLIC_MAX(CLIC_NEST_DEPTH(MAP_A), CLIC_NEST_DEPTH(MAP_B)). */
+#define CLIC_DEFINE_ISTACK(depth)                                                       \
+    uint8_t __attribute__((aligned(16))) clic_istack[CLIC_NUM_HARTS * CLIC_ISTACK_SIZE(depth)]; \
+    const uintptr_t clic_istack_size = CLIC_ISTACK_SIZE(depth)
+
+extern uint8_t clic_istack[];
+extern const uintptr_t clic_istack_size;
+
+/* Point mscratch at the top of the calling hart's interrupt stack, called
+ * by clic_hart_init() */
+void clic_istack_init(void);
+
+#if CLIC_ISTACK && !CLIC_HOST_MODEL
+
+#if __riscv_xlen == 64
+#define CLIC_ISTACK_S                           "sd"
+#define CLIC_ISTACK_L                           "ld"
+#define CLIC_ISTACK_R                           "8"
+#define CLIC_ISTACK_FRAME_STR                   "144"
+#elif defined(__riscv_32e)
+#define CLIC_ISTACK_S                           "sw"
+#define CLIC_ISTACK_L                           "lw"
+#define CLIC_ISTACK_R                           "4"
+#define CLIC_ISTACK_FRAME_STR                   "48"
+#else
+#define CLIC_ISTACK_S                           "sw"
+#define CLIC_ISTACK_L                           "lw"
+#define CLIC_ISTACK_R                           "4"
+#define CLIC_ISTACK_FRAME_STR                   "80"
+#endif
+
+#define CLIC_ISTACK_SAVE(reg, slot)             CLIC_ISTACK_S " " reg ", " #slot "*" CLIC_ISTACK_R "(sp)\n"
+#define CLIC_ISTACK_LOAD(reg, slot)             CLIC_ISTACK_L " " reg ", " #slot "*" CLIC_ISTACK_R "(sp)\n"
+
+#if defined(__riscv_32e)
+#define CLIC_ISTACK_REGS(op)                    op("ra", 0) op("t0", 1) op("t1", 2) op("t2", 3) \
+                                                op("a0", 4) op("a1", 5) op("a2", 6) op("a3", 7) \
+                                                op("a4", 8) op("a5", 9)
+#define CLIC_ISTACK_CSR_SLOT0                   "10"
+#define CLIC_ISTACK_CSR_SLOT1                   "11"
+#else
+#define CLIC_ISTACK_REGS(op)                    op("ra", 0) op("t0", 1) op("t1", 2) op("t2", 3) \
+                                                op("a0", 4) op("a1", 5) op("a2", 6) op("a3", 7) \
+                                                op("a4", 8) op("a5", 9) op("a6", 10) op("a7", 11) \
+                                                op("t3", 12) op("t4", 13) op("t5", 14) op("t6", 15)
+#define CLIC_ISTACK_CSR_SLOT0                   "16"
+#define CLIC_ISTACK_CSR_SLOT1                   "17"
+#endif
+
+/* Attribute a new interrupt stack watermark to this handler, clic_stack.h */
+#if CLIC_STACK_WATCH
+#define CLIC_ISTACK_WATCH                       "call clic_stack_watch\n"
+#else
+#define CLIC_ISTACK_WATCH                       ""
+#endif
+
+/* Entry stub handler_istack, emitted once per translation unit even if the
+ * handler appears in several maps */
+#define CLIC_ISTACK_STUB_ASM(h)                                                         \
+    ".ifndef " h "_istack\n"                                                            \
+    ".pushsection .text." h "_istack,\"ax\",@progbits\n"                                \
+    ".balign 4\n"                                                                       \
+    ".globl " h "_istack\n"                                                             \
+    ".type " h "_istack, @function\n"                                                   \
+    h "_istack:\n"                                                                      \
+    "csrrw sp, 0x349, sp\n"                     /* mscratchcswl */                      \
+    "addi sp, sp, -" CLIC_ISTACK_FRAME_STR "\n"                                         \
+    CLIC_ISTACK_REGS(CLIC_ISTACK_SAVE)                                                  \
+    "csrr t0, mcause\n"                                                                 \
+    "csrr t1, mepc\n"                                                                   \
+    CLIC_ISTACK_S " t0, " CLIC_ISTACK_CSR_SLOT0 "*" CLIC_ISTACK_R "(sp)\n"              \
+    CLIC_ISTACK_S " t1, " CLIC_ISTACK_CSR_SLOT1 "*" CLIC_ISTACK_R "(sp)\n"              \
+    "csrsi mstatus, 8\n"                                                                \
+    "call " h "\n"                                                                      \
+    "csrci mstatus, 8\n"                                                                \
+    CLIC_ISTACK_WATCH                                                                   \
+    CLIC_ISTACK_L " t0, " CLIC_ISTACK_CSR_SLOT0 "*" CLIC_ISTACK_R "(sp)\n"              \
+    CLIC_ISTACK_L " t1, " CLIC_ISTACK_CSR_SLOT1 "*" CLIC_ISTACK_R "(sp)\n"              \
+    "csrw mcause, t0\n"                         /* mpil decides the swap back */        \
+    "csrw mepc, t1\n"                                                                   \
+    CLIC_ISTACK_REGS(CLIC_ISTACK_LOAD)                                                  \
+    "addi sp, sp, " CLIC_ISTACK_FRAME_STR "\n"                                          \
+    "csrrw sp, 0x349, sp\n"                                                             \
+    "mret\n"                                                                            \
+    ".size " h "_istack, . - " h "_istack\n"                                            \
+    ".popsection\n"                                                                     \
+    ".endif\n"
+
+#define CLIC_ISTACK_STUB_ENTRY(int_id, level, priority, shv, trigger, handler)          \
+    void handler##_istack (void);                                                       \
+    __asm__ (CLIC_ISTACK_STUB_ASM(#handler));
+
+/* What the vector tables point at */
+#define CLIC_ISTACK_STUBS(map)                  map(CLIC_ISTACK_STUB_ENTRY)
+#define CLIC_VECTOR_TARGET(handler)             handler##_istack
+
+#else
+
+#define CLIC_ISTACK_STUBS(map)
+#define CLIC_VECTOR_TARGET(handler)             handler
+
+#endif /* CLIC_ISTACK && !CLIC_HOST_MODEL */
+
+#endif /* CLIC_ISTACK_H */
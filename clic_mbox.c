@@ -0,0 +1,39 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_mbox.h"
+
+clic_mbox_ring_t clic_mbox[CLIC_NUM_HARTS][CLIC_NUM_HARTS];
+
+void clic_mbox_run(void) {
+
+    clic_ctx_t *ctx = clic_ctx();
+    uintptr_t hartid = ctx->hartid;
+    clic_mbox_ring_t *ring;
+    clic_msg_t msg;
+    unsigned from;
+    int more;
+
+    /* A doorbell rung from here on is kept, and its message is visible */
+    write_word(ctx->msip, 0x0);
+    memory_fence(o, r);
+    ctx->doorbells++;
+
+    do {
+        for (from = 0; from < CLIC_NUM_HARTS; from++) {
+            ring = &clic_mbox[hartid][from];
+            while (clic_mbox_ring_pop1(ring, &msg)) {
+                ctx->messages++;
+                msg.fn(from, msg.arg);
+            }
+        }
+
+        /* tail stores before the head loads: a sender that still saw its
+         * ring non-empty did not ring, so its message must be found here */
+        memory_fence(rw, rw);
+        more = 0;
+        for (from = 0; from < CLIC_NUM_HARTS; from++)
+            if (clic_mbox_ring_count(&clic_mbox[hartid][from], 1))
+                more = 1;
+    } while (more);
+}
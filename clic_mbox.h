@@ -0,0 +1,81 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Inter-hart mailbox, rung through the receiving hart's MSIP (software
+ * interrupt #3).
+ *
+ * A message is a function and an argument, run on the receiving hart from
+ * software_handler:
+ *
+ *   static void flush_done (unsigned from, uintptr_t arg) { ... }
+ *
+ *   clic_mbox_send(1, flush_done, (uintptr_t)buf);     runs on hart 1
+ *
+ * Every hart has one wait-free ring per sender (clic_ring.h), so senders
+ * never contend.  MSIP is only written when a ring goes from empty to
+ * non-empty; a burst of messages costs one interrupt and one MMIO store.
+ * The receiver clears MSIP before draining and checks every ring again
+ * after a full fence, so a message sent while it drains is either seen by
+ * that pass or rings again.
+ *
+ * Messages to the own hart work too and take the same path.
+ */
+
+#ifndef CLIC_MBOX_H
+#define CLIC_MBOX_H
+
+#include "clic_hal.h"
+#include "clic_crit.h"
+#include "clic_ring.h"
+#include "clic_trace.h"
+
+/* Messages in flight per sender/receiver pair, a power of two */
+#ifndef CLIC_MBOX_DEPTH
+#define CLIC_MBOX_DEPTH                         16
+#endif
+
+typedef struct {
+    void (*fn)(unsigned from, uintptr_t arg);
+    uintptr_t arg;
+} clic_msg_t;
+
+CLIC_RING_DEFINE(clic_mbox_ring, clic_msg_t, CLIC_MBOX_DEPTH);
+
+/* clic_mbox[to][from] */
+extern clic_mbox_ring_t clic_mbox[CLIC_NUM_HARTS][CLIC_NUM_HARTS];
+
+/* Queue fn(from, arg) on hart `to`, from any context.  Interrupts are held
+ * off for the ring update so that handlers of every level can send.
+ * Returns 0 if that hart's ring for this sender is full. */
+static inline __attribute__((always_inline)) int clic_mbox_send (unsigned to, void (*fn)(unsigned from, uintptr_t arg), uintptr_t arg) {
+
+    clic_mbox_ring_t *ring = &clic_mbox[to][clic_ctx()->hartid];
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+    int kick;
+
+    if (!clic_mbox_ring_space(ring, 1)) {
+        clic_crit_exit(crit);
+        return 0;
+    }
+    ring->slot[ring->head & (CLIC_MBOX_DEPTH - 1)] = (clic_msg_t){ fn, arg };
+    clic_mbox_ring_commit(ring, 1);
+    /* head store before the tail load, pairs with the fence in clic_mbox_run() */
+    memory_fence(rw, rw);
+    kick = ring->head - ring->tail == 1;
+    clic_crit_exit(crit);
+
+    /* Pending for the receiver whether this send rings or MSIP is still set */
+    CLIC_TRACE_PEND(INT_ID_SOFTWARE);
+    if (kick) {
+        memory_fence(w, o);
+        write_word(MSIP_BASE_ADDR(to), 0x1);
+    }
+    return 1;
+}
+
+/* Clear this hart's MSIP and run every message queued for it, called by
+ * software_handler */
+void clic_mbox_run(void);
+
+#endif /* CLIC_MBOX_H */
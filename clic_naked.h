@@ -0,0 +1,118 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Minimal-save handlers for short, non-preemptible interrupts.
+ *
+ * A "SiFive-CLIC-preemptible" handler saves mcause and mepc and re-enables
+ * interrupts before its first statement, which dominates a body of one or
+ * two stores.  Two lighter classes:
+ *
+ *   CLIC_FAST               plain "interrupt" attribute: the compiler saves
+ *                           only the registers the C body uses, interrupts
+ *                           stay off until mret
+ *   CLIC_NAKED_HANDLER()    hand written entry that saves t0 and t1 only,
+ *                           around a body in assembly that uses nothing else
+ *
+ *   CLIC_NAKED_HANDLER(clic_software_fast,
+ *       CLIC_NAKED_CLEAR_IP(12),
+ *       write_byte(CLICINTIP_ADDR(12), DISABLE));
+ *
+ * The third argument is the same body in C for the host model.  The body
+ * may not call functions or touch the stack, and finds this hart's
+ * context block (clic_ctx.h) through tp.  Both classes run to completion
+ * at their level and are meant for a handful of instructions.
+ *
+ * Naked handlers can be listed in IRQ maps; with CLIC_ISTACK they define
+ * handler_istack as an alias of themselves, so they must come before the
+ * vector table in the file and no stack switch is generated for them.
+ * CLIC_FAST handlers are only for tables without CLIC_ISTACK.  The
+ * clic_software classes of the benchmark compare all three.
+ */
+
+#ifndef CLIC_NAKED_H
+#define CLIC_NAKED_H
+
+#include <stddef.h>
+
+#include "clic_hal.h"
+
+#define CLIC_FAST                               CLIC_INTERRUPT
+
+#define CLIC_NAKED_STR_(x)                      #x
+#define CLIC_NAKED_STR(x)                       CLIC_NAKED_STR_(x)
+
+#if CLIC_HOST_MODEL
+
+#define CLIC_NAKED_HANDLER(name, body, host_body)                                       \
+    void name (void) { host_body; }                                                     \
+    void name (void)
+
+#else
+
+#if __riscv_xlen == 64
+#define CLIC_NAKED_S                            "sd"
+#define CLIC_NAKED_L                            "ld"
+#define CLIC_NAKED_R                            "8"
+#else
+#define CLIC_NAKED_S                            "sw"
+#define CLIC_NAKED_L                            "lw"
+#define CLIC_NAKED_R                            "4"
+#endif
+
+#if CLIC_ISTACK
+#define CLIC_NAKED_ISTACK_ALIAS(name)           ".globl " name "_istack\n"                  \
+                                                ".set " name "_istack, " name "\n"
+#else
+#define CLIC_NAKED_ISTACK_ALIAS(name)
+#endif
+
+#define CLIC_NAKED_ASM(name, body)                                                      \
+    ".pushsection .text." name ",\"ax\",@progbits\n"                                    \
+    ".balign 4\n"                                                                       \
+    ".globl " name "\n"                                                                 \
+    ".type " name ", @function\n"                                                       \
+    name ":\n"                                                                          \
+    "addi sp, sp, -16\n"                                                                \
+    CLIC_NAKED_S " t0, 0(sp)\n"                                                         \
+    CLIC_NAKED_S " t1, " CLIC_NAKED_R "(sp)\n"                                          \
+    body                                                                                \
+    CLIC_NAKED_L " t0, 0(sp)\n"                                                         \
+    CLIC_NAKED_L " t1, " CLIC_NAKED_R "(sp)\n"                                          \
+    "addi sp, sp, 16\n"                                                                 \
+    "mret\n"                                                                            \
+    ".size " name ", . - " name "\n"                                                    \
+    CLIC_NAKED_ISTACK_ALIAS(name)                                                       \
+    ".popsection\n"
+
+/* The trailing declaration takes the caller's semicolon */
+#define CLIC_NAKED_HANDLER(name, body, host_body)                                       \
+    __asm__ (CLIC_NAKED_ASM(#name, body));                                              \
+    void name (void)
+
+#endif /* CLIC_HOST_MODEL */
+
+/* Body building blocks, t0 and t1 only */
+
+_Static_assert(offsetof(clic_ctx_t, clic) == 3 * sizeof(uintptr_t) && METAL_SIFIVE_CLIC0_CLICINTIP_BASE == 0,
+               "CLIC_NAKED_CLEAR_IP() hard codes the clic_ctx_t layout and clicintip offset");
+
+/* clicintip[int_id] = 0 on this hart's CLIC, through clic_ctx()->clic */
+#define CLIC_NAKED_CLEAR_IP(int_id)                                                     \
+    CLIC_NAKED_L " t0, 3*" CLIC_NAKED_R "(tp)\n"                                        \
+    "sb zero, " CLIC_NAKED_STR(int_id) "(t0)\n"
+
+/* A 32-bit variable = mcycle */
+#define CLIC_NAKED_STAMP(var)                                                           \
+    "csrr t1, mcycle\n"                                                                 \
+    "la t0, " #var "\n"                                                                 \
+    "sw t1, 0(t0)\n"
+
+/* A 32-bit variable += 1 */
+#define CLIC_NAKED_INC(var)                                                             \
+    "la t0, " #var "\n"                                                                 \
+    "lw t1, 0(t0)\n"                                                                    \
+    "addi t1, t1, 1\n"                                                                  \
+    "sw t1, 0(t0)\n"
+
+#endif /* CLIC_NAKED_H */
@@ -0,0 +1,62 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_nxti.h"
+#include "clic_stack.h"
+#include "clic_crash.h"
+
+typedef void (*clic_nxti_handler_t)(void);
+
+#if CLIC_HOST_MODEL
+
+void __attribute__((aligned(64))) clic_nxti_trap (void) {
+
+    if (!(read_csr(mcause) & MCAUSE_INTR))
+        CLIC_CRASH_ENTRY();
+    clic_nxti_dispatch();
+}
+
+#else
+
+void __attribute__((CLIC_CRASH_HANDLER, aligned(64))) clic_nxti_trap (void) {
+
+    __asm__ volatile ("csrrw t0, mscratch, t0\n"
+                      "csrr t0, mcause\n"
+                      "bltz t0, 1f\n"          /* mcause.interrupt */
+                      "csrrw t0, mscratch, t0\n"
+                      CLIC_CRASH_ENTRY_ASM
+                      "1:\n"
+                      "csrrw t0, mscratch, t0\n"
+                      "j clic_nxti_dispatch\n");
+}
+
+#endif
+
+void __attribute__((CLIC_INTERRUPT)) clic_nxti_dispatch (void) {
+
+    uintptr_t mcause = read_csr(mcause);
+    uintptr_t mepc = read_csr(mepc);
+    uintptr_t *entry;
+
+#if CLIC_STACK_WATCH
+    clic_stack_watch_entry();
+#endif
+
+    /* 0x345 is mnxti.  The first claim returns the interrupt that trapped
+     * here, since mnxti compares against mcause.mpil and not the level we
+     * are running at.  The csrrsi re-enables interrupts for the handler,
+     * the csrrci closes them again before the next claim. */
+    while ((entry = (uintptr_t *)set_csr(0x345, METAL_MIE_INTERRUPT)) != 0) {
+        ((clic_nxti_handler_t)*entry)();
+        clear_csr(mstatus, METAL_MIE_INTERRUPT);
+#if CLIC_STACK_WATCH
+        clic_stack_watch();
+#endif
+    }
+
+    /* A preempting non-preemptible handler overwrites mepc/mcause and
+     * mnxti rewrote mcause.exccode, put back what mret needs */
+    clear_csr(mstatus, METAL_MIE_INTERRUPT);
+    write_csr(mcause, mcause);
+    write_csr(mepc, mepc);
+}
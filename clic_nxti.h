@@ -0,0 +1,48 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Tail chaining dispatcher for non-SHV interrupts, built on the CLIC mnxti
+ * CSR.
+ *
+ * Every "SiFive-CLIC-preemptible" handler saves and restores the whole
+ * caller saved context for a single interrupt.  clic_nxti_dispatch() is
+ * installed at mtvec.base instead and, once its context is saved, keeps
+ * claiming the highest pending interrupt through mnxti until none is left
+ * above the interrupted level, so a burst costs one save/restore.
+ *
+ * An interrupt goes through the dispatcher when it is non-SHV: cliccfg.NVBITS
+ * is 1 and its CLIC_IRQ_MAP line has shv = 0.  Its handler is still found in
+ * __mtvt_clic_vector_table, but since the dispatcher calls it, it is a plain
+ * function and not an interrupt handler:
+ *
+ *   void lc5_work (void);
+ *   IRQ(21, 255, 255, 0, CLIC_TRIGGER_LEVEL, lc5_work)
+ *
+ * Handlers run with interrupts enabled, so higher levels still preempt
+ * them; mcause holds the ID being serviced, as for vectored handlers.
+ */
+
+#ifndef CLIC_NXTI_H
+#define CLIC_NXTI_H
+
+#include "clic_hal.h"
+
+/* Define to 1 to install clic_nxti_dispatch() at mtvec.base and turn on
+ * selective hardware vectoring (cliccfg.NVBITS = 1) in main() */
+#ifndef CLIC_NXTI_DISPATCH
+#define CLIC_NXTI_DISPATCH                      0
+#endif
+
+/* Common trap handler, entered from clic_nxti_trap() for interrupts */
+void __attribute__((CLIC_INTERRUPT)) clic_nxti_dispatch (void);
+
+/* What main() installs at mtvec.base.  Exceptions trap there too: it tells
+ * them apart by the sign of mcause before anything touches the stack, which
+ * may be the one that overflowed, and goes straight to the crash capture
+ * (CLIC_CRASH_ENTRY(), clic_crash.h) with the faulting sp and ra.
+ * Interrupts go on to clic_nxti_dispatch().  t0 is parked in mscratch for
+ * the test, free since CLIC_ISTACK is not supported here. */
+void clic_nxti_trap (void);
+
+#endif /* CLIC_NXTI_H */
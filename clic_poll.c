@@ -0,0 +1,104 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include <stdio.h>
+
+#include "clic_poll.h"
+
+static void to_irq(clic_poll_t *poll, uint64_t now) {
+
+    clic_periodic_stop(&poll->tick);
+    poll->polling = 0;
+    poll->events = 0;
+    poll->window_start = now;
+    /* A level still asserted, or an edge latched while polling, is taken
+     * as soon as the line is enabled, nothing gets lost in between */
+    write_byte(CLICINTIE_ADDR(poll->int_id), ENABLE);
+}
+
+void clic_poll_irq(clic_poll_t *poll) {
+
+    uint64_t now = clic_timer_now();
+
+    if (now - poll->window_start >= poll->window) {
+        poll->window_start = now;
+        poll->events = 0;
+    }
+    poll->events++;
+    poll->stats.irq_events++;
+    poll->fn(poll);
+
+    if (poll->events < poll->enter)
+        return;
+    write_byte(CLICINTIE_ADDR(poll->int_id), DISABLE);
+    poll->polling = 1;
+    poll->events = 0;
+    poll->window_start = now;
+    poll->stats.to_poll++;
+    /* Start draining now, then every interval */
+    clic_periodic_start(&poll->tick, now + poll->interval, poll->interval);
+    clic_defer(&poll->work);
+}
+
+unsigned clic_poll_run(clic_poll_t *poll) {
+
+    unsigned n;
+
+    for (n = 0; n < poll->budget && (read_byte(CLICINTIP_ADDR(poll->int_id)) & 1); n++)
+        poll->fn(poll);
+    poll->stats.polls++;
+    poll->stats.poll_events += n;
+    if (n == poll->budget)
+        poll->stats.exhausted++;
+    return n;
+}
+
+void clic_poll_work(clic_work_t *work) {
+
+    clic_poll_t *poll = (clic_poll_t *)((char *)work - offsetof(clic_poll_t, work));
+    uint64_t now;
+    unsigned n;
+
+    /* Queued by a tick that raced with the switch back */
+    if (!poll->polling)
+        return;
+    n = clic_poll_run(poll);
+    poll->events += n;
+
+    now = clic_timer_now();
+    if (now - poll->window_start < poll->window)
+        return;
+    /* A poll that ran out of budget left the line busy, whatever the count */
+    if (poll->events <= poll->leave && n < poll->budget) {
+        poll->stats.to_irq++;
+        to_irq(poll, now);
+        return;
+    }
+    poll->window_start = now;
+    poll->events = 0;
+}
+
+void clic_poll_tick(clic_periodic_t *periodic) {
+
+    clic_poll_t *poll = (clic_poll_t *)((char *)periodic - offsetof(clic_poll_t, tick));
+
+    clic_defer(&poll->work);
+}
+
+void clic_poll_reset(clic_poll_t *poll) {
+
+    to_irq(poll, clic_timer_now());
+}
+
+void clic_poll_print_header(void) {
+
+    printf("poll,id,irq_events,poll_events,polls,exhausted,to_poll,to_irq\n");
+}
+
+void clic_poll_print(const clic_poll_t *poll) {
+
+    printf("poll,%u,%lu,%lu,%lu,%lu,%lu,%lu\n", poll->int_id,
+           (unsigned long)poll->stats.irq_events, (unsigned long)poll->stats.poll_events,
+           (unsigned long)poll->stats.polls, (unsigned long)poll->stats.exhausted,
+           (unsigned long)poll->stats.to_poll, (unsigned long)poll->stats.to_irq);
+}
@@ -0,0 +1,95 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Adaptive interrupt moderation for the local external lines, NAPI style.
+ *
+ * At low event rates a line interrupts once per event.  When more than
+ * 'enter' events arrive within one 'window' of mtime ticks the line's
+ * clicintie is cleared and the line is polled instead: every 'interval'
+ * ticks a periodic timer queues a poll as deferred work (#12), and the poll
+ * services up to 'budget' events while clicintip reads set.  Once a whole
+ * window sees no more than 'leave' events, clicintie is set again.  'leave'
+ * below 'enter' is the hysteresis that keeps a line near the threshold from
+ * flipping between the two modes every window.
+ *
+ *   static void rx_event (clic_poll_t *poll) { ... pop one entry of the device FIFO ... }
+ *   static clic_poll_t rx = CLIC_POLL_INIT(16, rx_event, 16, 64, 8,
+ *                                          CLIC_POLL_TICKS(1000), CLIC_POLL_TICKS(8000));
+ *
+ *   in lc0_handler:     clic_poll_irq(&rx);
+ *
+ * fn handles one event and must leave clicintip clear once the device has
+ * nothing more: acknowledge the device on level triggered lines, write
+ * clicintip on edge triggered ones.  It runs from the line's handler in
+ * interrupt mode and from #12 in polled mode.  A budget used up leaves the
+ * rest for the next tick, so a flooding line takes a bounded share of the
+ * hart instead of all of it.
+ *
+ * Polling rides on the timer wheel, which the boot hart owns: moderate the
+ * boot hart's lines only.
+ */
+
+#ifndef CLIC_POLL_H
+#define CLIC_POLL_H
+
+#include "clic_hal.h"
+#include "clic_defer.h"
+#include "clic_time.h"
+#include "clic_timer.h"
+
+/* Rate window or poll interval as a constant, for CLIC_POLL_INIT(), rounded
+ * to the nearest tick: 8 kHz on a 32768 Hz mtime is 4 ticks, 122 us */
+#define CLIC_POLL_TICKS(hz)                     ((CLIC_MTIME_FREQ + (hz) / 2) / (hz))
+
+typedef struct clic_poll_stats {
+    uint32_t irq_events;                /* events handled from the line's interrupt */
+    uint32_t poll_events;               /* events handled by polls */
+    uint32_t polls;
+    uint32_t exhausted;                 /* polls that used up their budget */
+    uint32_t to_poll;                   /* switches to polled mode */
+    uint32_t to_irq;                    /* switches back to interrupts */
+} clic_poll_stats_t;
+
+typedef struct clic_poll {
+    clic_work_t work;                   /* one poll, queued by tick */
+    clic_periodic_t tick;               /* runs while polling */
+    void (*fn)(struct clic_poll *poll);
+    uint16_t int_id;
+    uint16_t budget;                    /* events per poll */
+    uint32_t enter;                     /* events per window that switch to polling */
+    uint32_t leave;                     /* events per window that switch back */
+    uint32_t window;                    /* mtime ticks */
+    uint32_t interval;                  /* mtime ticks between polls */
+    /* The line's handler and the polls never run at the same time: the
+     * line is disabled while polling.  volatile keeps the state written
+     * before the clicintie store that hands it over. */
+    volatile uint8_t polling;
+    volatile uint32_t events;           /* in the current window */
+    volatile uint64_t window_start;
+    clic_poll_stats_t stats;
+} clic_poll_t;
+
+void clic_poll_work(clic_work_t *work);
+void clic_poll_tick(clic_periodic_t *periodic);
+
+#define CLIC_POLL_INIT(int_id, fn, budget, enter, leave, window, interval)                   \
+    { CLIC_WORK_INIT(clic_poll_work), CLIC_PERIODIC_INIT(clic_poll_tick), (fn), (int_id),   \
+      (budget), (enter), (leave), (window), (interval), 0, 0, 0, { 0, 0, 0, 0, 0, 0 } }
+
+/* From the line's handler: handle the event, count it against the window
+ * and hand the line over to polling when the rate is above 'enter' */
+void clic_poll_irq(clic_poll_t *poll);
+
+/* One poll of up to 'budget' events, regardless of the mode; returns the
+ * number handled.  The deferred poll is built on it. */
+unsigned clic_poll_run(clic_poll_t *poll);
+
+/* Back to interrupt mode and a fresh window, e.g. before reconfiguring */
+void clic_poll_reset(clic_poll_t *poll);
+
+/* CSV rows of the interrupt vs poll split, one per line */
+void clic_poll_print_header(void);
+void clic_poll_print(const clic_poll_t *poll);
+
+#endif /* CLIC_POLL_H */
@@ -0,0 +1,40 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_prof.h"
+#include "clic_timer.h"
+
+#if CLIC_PROF
+
+clic_prof_t clic_prof;
+clic_prof_sample_t clic_prof_latch;
+
+static void prof_tick(clic_periodic_t *periodic) {
+
+    clic_prof.sample[clic_prof.count++] = clic_prof_latch;
+    if (clic_prof.count == CLIC_PROF_DEPTH)
+        clic_timer_cancel(&periodic->timer);
+}
+
+static clic_periodic_t prof_timer = CLIC_PERIODIC_INIT(prof_tick);
+
+void clic_prof_start(unsigned hz) {
+
+    uint64_t period = hz && hz < CLIC_MTIME_FREQ ? CLIC_MTIME_FREQ / hz : 1;
+
+    clic_prof_stop();
+    clic_prof.magic = CLIC_PROF_MAGIC;
+    clic_prof.count = 0;
+    clic_prof.depth = CLIC_PROF_DEPTH;
+    clic_prof.xlen = sizeof(uintptr_t) * 8;
+    clic_prof.hz = (uint32_t)(CLIC_MTIME_FREQ / period);
+    clic_prof.reserved = 0;
+    clic_periodic_start(&prof_timer, clic_timer_now() + period, period);
+}
+
+void clic_prof_stop(void) {
+
+    clic_timer_cancel(&prof_timer.timer);
+}
+
+#endif
@@ -0,0 +1,84 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Sampling profiler on the machine timer, built with CLIC_PROF=1.
+ *
+ * clic_prof_start(hz) runs a periodic software timer (clic_timer.h) at hz.
+ * timer_handler latches mepc and ra of the interrupted code with
+ * CLIC_PROF_ENTRY() as its first statement, and the profiler's timer
+ * callback commits that latch to clic_prof as one sample.  Other timers
+ * expiring in the same interrupt do not add samples, so the rate stays
+ * the requested one and samples are not biased towards their deadlines.
+ *
+ * ra is that of the interrupted function when it is a leaf or has not
+ * saved it yet, else usually its caller's: good enough for a one level
+ * caller;callee profile.  Code running at or above the timer's level, and
+ * with interrupts off, is not sampled; it shows up where it re-enabled
+ * them.  The timer wheel belongs to the boot hart, so does the profile.
+ *
+ * Samples stop when the buffer is full.  tools/clic_prof_symbolize maps a
+ * memory dump of clic_prof against the ELF:
+ *
+ *   (gdb) dump binary value prof.bin clic_prof
+ *   $ tools/clic_prof_symbolize example-clic-baremetal prof.bin
+ *
+ * and prints a flat profile, or with -f folded stacks for flamegraph.pl.
+ * The highest rate is bounded by CLIC_MTIME_FREQ (clic_time.h).
+ */
+
+#ifndef CLIC_PROF_H
+#define CLIC_PROF_H
+
+#include "clic_hal.h"
+
+/* Rate main() profiles at */
+#ifndef CLIC_PROF_HZ
+#define CLIC_PROF_HZ                            1000
+#endif
+
+/* Samples kept */
+#ifndef CLIC_PROF_DEPTH
+#define CLIC_PROF_DEPTH                         1024
+#endif
+
+#define CLIC_PROF_MAGIC                         0xC1C0960FUL
+
+typedef struct clic_prof_sample {
+    uintptr_t pc;
+    uintptr_t ra;
+} clic_prof_sample_t;
+
+/* Layout shared with tools/clic_prof_symbolize.c: a 24-byte header, then
+ * the samples, little endian in the target's XLEN */
+typedef struct clic_prof {
+    uint32_t magic;
+    uint32_t count;                 /* samples taken, up to CLIC_PROF_DEPTH */
+    uint32_t depth;
+    uint32_t hz;                    /* rate actually used */
+    uint32_t xlen;
+    uint32_t reserved;
+    clic_prof_sample_t sample[CLIC_PROF_DEPTH];
+} clic_prof_t;
+
+extern clic_prof_t clic_prof;
+extern clic_prof_sample_t clic_prof_latch;
+
+/* The stubs call timer_handler, so its ra would be theirs */
+#if CLIC_PROF && CLIC_ISTACK && !CLIC_HOST_MODEL
+#error "CLIC_PROF latches ra in timer_handler, which the CLIC_ISTACK stubs call"
+#endif
+
+#if CLIC_PROF
+#define CLIC_PROF_ENTRY()                       do { clic_prof_latch.pc = read_csr(mepc);           \
+                                                     clic_prof_latch.ra = read_ra(); } while (0)
+#else
+#define CLIC_PROF_ENTRY()
+#endif
+
+/* Clear the samples and sample at hz, from the boot hart */
+void clic_prof_start(unsigned hz);
+
+void clic_prof_stop(void);
+
+#endif /* CLIC_PROF_H */
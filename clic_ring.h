@@ -0,0 +1,154 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Wait-free single producer / single consumer ring, for handing data from
+ * interrupt handlers to the main loop (or between two harts).
+ *
+ * CLIC_RING_DEFINE(name, type, capacity) generates a ring type name_t and
+ * its static inline functions:
+ *
+ *   CLIC_RING_DEFINE(event_ring, struct event, 64);
+ *   static event_ring_t events;
+ *
+ *   in lc0_handler:     event_ring_push1(&events, &ev);
+ *   in the main loop:   while (event_ring_pop1(&events, &ev)) ...
+ *
+ * Batched calls move up to n elements and return how many were moved.
+ * reserve/commit and peek/release work in place: reserve returns the next
+ * contiguous free slots (count in *n), commit publishes them; peek returns
+ * the next contiguous filled slots, release hands them back.
+ *
+ * head and tail are free running 32-bit counters on separate cache lines,
+ * each written by one side only, so both sides use plain loads and stores.
+ * The capacity must be a power of two.  The fences order the slot accesses
+ * against the index updates; on a single hart they only stop the compiler
+ * from reordering, across harts they are the RISC-V fences that make the
+ * ring safe without atomics.
+ */
+
+#ifndef CLIC_RING_H
+#define CLIC_RING_H
+
+#include <string.h>
+
+#include "clic_hal.h"
+
+#ifndef CLIC_CACHE_LINE
+#define CLIC_CACHE_LINE                         64
+#endif
+
+#define CLIC_RING_DEFINE(name, type, capacity)                                              \
+                                                                                            \
+_Static_assert((capacity) > 0 && ((capacity) & ((capacity) - 1)) == 0,                      \
+               #name " capacity must be a power of two");                                   \
+                                                                                            \
+typedef struct {                                                                            \
+    /* producer side */                                                                     \
+    volatile uint32_t head __attribute__((aligned(CLIC_CACHE_LINE)));                      \
+    uint32_t tail_cache;                                                                    \
+    /* consumer side */                                                                     \
+    volatile uint32_t tail __attribute__((aligned(CLIC_CACHE_LINE)));                      \
+    uint32_t head_cache;                                                                    \
+    type slot[capacity] __attribute__((aligned(CLIC_CACHE_LINE)));                         \
+} name##_t;                                                                                 \
+                                                                                            \
+static inline __attribute__((always_inline)) void name##_init(name##_t *r) {                \
+    r->head = r->tail = r->tail_cache = r->head_cache = 0;                                  \
+}                                                                                           \
+                                                                                            \
+/* Producer: free slots, refreshing the cached tail only when needed */                    \
+static inline __attribute__((always_inline)) uint32_t name##_space(name##_t *r, uint32_t want) { \
+    uint32_t space = (capacity) - (r->head - r->tail_cache);                                \
+    if (space < want) {                                                                     \
+        r->tail_cache = r->tail;                                                            \
+        /* slots are not written before the consumer is done reading them */               \
+        memory_fence(r, w);                                                                 \
+        space = (capacity) - (r->head - r->tail_cache);                                     \
+    }                                                                                       \
+    return space;                                                                           \
+}                                                                                           \
+                                                                                            \
+/* Consumer: filled slots, refreshing the cached head only when needed */                  \
+static inline __attribute__((always_inline)) uint32_t name##_count(name##_t *r, uint32_t want) { \
+    uint32_t used = r->head_cache - r->tail;                                                \
+    if (used < want) {                                                                      \
+        r->head_cache = r->head;                                                            \
+        /* slots are not read before the producer has written them */                      \
+        memory_fence(r, r);                                                                 \
+        used = r->head_cache - r->tail;                                                     \
+    }                                                                                       \
+    return used;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline __attribute__((always_inline)) type *name##_reserve(name##_t *r, uint32_t *n) { \
+    uint32_t at = r->head & ((capacity) - 1);                                               \
+    uint32_t space = name##_space(r, *n);                                                   \
+    if (space > (capacity) - at)                                                            \
+        space = (capacity) - at;                                                            \
+    if (*n > space)                                                                         \
+        *n = space;                                                                         \
+    return &r->slot[at];                                                                    \
+}                                                                                           \
+                                                                                            \
+static inline __attribute__((always_inline)) void name##_commit(name##_t *r, uint32_t n) {  \
+    memory_fence(w, w);                                                                     \
+    r->head = r->head + n;                                                                  \
+}                                                                                           \
+                                                                                            \
+static inline __attribute__((always_inline)) type *name##_peek(name##_t *r, uint32_t *n) {  \
+    uint32_t at = r->tail & ((capacity) - 1);                                               \
+    uint32_t used = name##_count(r, *n);                                                    \
+    if (used > (capacity) - at)                                                             \
+        used = (capacity) - at;                                                             \
+    if (*n > used)                                                                          \
+        *n = used;                                                                          \
+    return &r->slot[at];                                                                    \
+}                                                                                           \
+                                                                                            \
+static inline __attribute__((always_inline)) void name##_release(name##_t *r, uint32_t n) { \
+    memory_fence(r, w);                                                                     \
+    r->tail = r->tail + n;                                                                  \
+}                                                                                           \
+                                                                                            \
+/* One element, the ISR fast path: returns 0 when the ring is full */                      \
+static inline __attribute__((always_inline)) int name##_push1(name##_t *r, const type *v) { \
+    if (!name##_space(r, 1))                                                                \
+        return 0;                                                                           \
+    r->slot[r->head & ((capacity) - 1)] = *v;                                               \
+    name##_commit(r, 1);                                                                    \
+    return 1;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline __attribute__((always_inline)) int name##_pop1(name##_t *r, type *v) {        \
+    if (!name##_count(r, 1))                                                                \
+        return 0;                                                                           \
+    *v = r->slot[r->tail & ((capacity) - 1)];                                               \
+    name##_release(r, 1);                                                                   \
+    return 1;                                                                               \
+}                                                                                           \
+                                                                                            \
+/* Batches, in at most two copies around the wrap and one index update */                  \
+static inline uint32_t name##_push(name##_t *r, const type *v, uint32_t n) {                \
+    uint32_t space = name##_space(r, n), at = r->head & ((capacity) - 1), first;            \
+    if (n > space)                                                                          \
+        n = space;                                                                          \
+    first = n < (capacity) - at ? n : (capacity) - at;                                      \
+    memcpy(&r->slot[at], v, first * sizeof(type));                                          \
+    memcpy(&r->slot[0], v + first, (n - first) * sizeof(type));                             \
+    name##_commit(r, n);                                                                    \
+    return n;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint32_t name##_pop(name##_t *r, type *v, uint32_t n) {                       \
+    uint32_t used = name##_count(r, n), at = r->tail & ((capacity) - 1), first;             \
+    if (n > used)                                                                           \
+        n = used;                                                                           \
+    first = n < (capacity) - at ? n : (capacity) - at;                                      \
+    memcpy(v, &r->slot[at], first * sizeof(type));                                          \
+    memcpy(v + first, &r->slot[0], (n - first) * sizeof(type));                             \
+    name##_release(r, n);                                                                   \
+    return n;                                                                               \
+}
+
+#endif /* CLIC_RING_H */
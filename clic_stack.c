@@ -0,0 +1,139 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_stack.h"
+#include "clic_istack.h"
+#include "clic_crit.h"
+
+clic_stack_t clic_stacks[CLIC_NUM_HARTS][CLIC_STACK_KINDS];
+
+/* Room left above the painted area for clic_stack_paint()'s own frame */
+#define PAINT_MARGIN            64
+
+/* Lowest overwritten word between base and limit, limit if none */
+static uintptr_t lowest_written(uintptr_t base, uintptr_t limit) {
+
+    const uint32_t *w = (const uint32_t *)base;
+
+    while ((uintptr_t)w < limit && *w == (uint32_t)CLIC_STACK_PAINT)
+        w++;
+    return (uintptr_t)w < limit ? (uintptr_t)w : limit;
+}
+
+void clic_stack_paint(clic_stack_t *stack, uintptr_t base, uintptr_t size) {
+
+    uintptr_t sp = read_sp();
+    uintptr_t end = base + size;
+    uint32_t *w;
+
+    base = (base + 3) & ~(uintptr_t)3;
+    /* The live stack is only painted below what is in use */
+    if (sp - base < size)
+        end = sp - PAINT_MARGIN > base ? (sp - PAINT_MARGIN) & ~(uintptr_t)3 : base;
+    for (w = (uint32_t *)base; (uintptr_t)w < end; w++)
+        *w = (uint32_t)CLIC_STACK_PAINT;
+
+    stack->base = base;
+    stack->size = size;
+    stack->low = end;
+    stack->int_id = CLIC_STACK_UNKNOWN;
+    stack->level = 0;
+}
+
+void clic_stack_init(void) {
+
+    uintptr_t hartid = current_hartid();
+    clic_stack_t *stacks = clic_stacks[hartid];
+
+#if !CLIC_HOST_MODEL
+    /* freedom-metal's crt0 gives hart N the N-th __stack_size below _sp */
+    extern char _sp[], __stack_size[];
+    uintptr_t top = (uintptr_t)_sp - hartid * (uintptr_t)__stack_size;
+
+    clic_stack_paint(&stacks[CLIC_STACK_MAIN], top - (uintptr_t)__stack_size, (uintptr_t)__stack_size);
+#endif
+#if CLIC_ISTACK
+    clic_stack_paint(&stacks[CLIC_STACK_IRQ], (uintptr_t)&clic_istack[hartid * clic_istack_size], clic_istack_size);
+#endif
+    (void)stacks;
+}
+
+uintptr_t clic_stack_hwm(clic_stack_t *stack) {
+
+    clic_crit_t crit;
+    uintptr_t low;
+
+    if (!stack->base)
+        return 0;
+    /* Scan with interrupts on, a handler may only move the mark further */
+    low = lowest_written(stack->base, stack->low);
+    crit = clic_crit_enter(CLIC_CRIT_ALL);
+    if (low < stack->low) {
+        stack->low = low;
+        stack->int_id = CLIC_STACK_UNKNOWN;
+        stack->level = 0;
+    }
+    clic_crit_exit(crit);
+    return stack->base + stack->size - stack->low;
+}
+
+void clic_stack_account(clic_stack_t *stack, uintptr_t below, unsigned int_id, unsigned level) {
+
+    uintptr_t check = stack->low - CLIC_STACK_WATCH_BYTES;
+    const uint32_t *w;
+    uintptr_t low;
+
+    if (stack->low <= stack->base)
+        return;
+    if (check < stack->base)
+        check = stack->base;
+    /* Nothing new written just below the mark, the common case */
+    for (w = (const uint32_t *)check; (uintptr_t)w < stack->low; w++)
+        if (*w != (uint32_t)CLIC_STACK_PAINT)
+            break;
+    if ((uintptr_t)w == stack->low)
+        return;
+
+    low = lowest_written(stack->base, stack->low);
+    if (low >= below)
+        return;
+    stack->low = low;
+    stack->int_id = (uint16_t)int_id;
+    stack->level = (uint8_t)level;
+}
+
+/* The tracked stack sp is on, NULL if none */
+static clic_stack_t *current_stack(uintptr_t sp) {
+
+    clic_stack_t *stacks = clic_stacks[current_hartid()];
+    unsigned kind;
+
+    for (kind = 0; kind < CLIC_STACK_KINDS; kind++)
+        if (stacks[kind].base && sp - stacks[kind].base < stacks[kind].size)
+            return &stacks[kind];
+    return 0;
+}
+
+void clic_stack_watch(void) {
+
+    clic_stack_t *stack = current_stack(read_sp());
+
+    /* Anything new is the handler's, its frames above sp included */
+    if (stack)
+        clic_stack_account(stack, stack->low,
+                           MCAUSE_CODE(read_csr(mcause)),
+                           MINTSTATUS_MIL(read_csr(0x346)));   /* 0x346 is mintstatus */
+}
+
+void clic_stack_watch_entry(void) {
+
+    uintptr_t sp = read_sp();
+    clic_stack_t *stack = current_stack(sp);
+    unsigned level;
+
+    /* Below sp the handler has not written yet, what is there predates it */
+    if (stack) {
+        level = MCAUSE_MPIL(read_csr(mcause));
+        clic_stack_account(stack, sp, level ? CLIC_STACK_UNKNOWN : CLIC_STACK_THREAD, level);
+    }
+}
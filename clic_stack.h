@@ -0,0 +1,92 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Stack painting and high-water marks, built with CLIC_STACK_WATCH=1.
+ *
+ * clic_hart_init() fills the unused part of the hart's main stack (below
+ * the live sp) and, with CLIC_ISTACK, its whole interrupt stack with
+ * CLIC_STACK_PAINT.  clic_stack_hwm() later finds the lowest overwritten
+ * word, i.e. the deepest the stack has ever been, so stacks can be sized
+ * from data:
+ *
+ *   clic_stack_t *s = clic_stack_get(0, CLIC_STACK_MAIN);
+ *   used = clic_stack_hwm(s);           bytes, out of s->size
+ *
+ * clic_stack_watch() attributes excursions: called at the end of an
+ * interrupt it checks the words just below the known watermark of the
+ * stack sp is on, and if the interrupt pushed past it, moves the mark and
+ * records mcause's interrupt ID and the mintstatus level.  A nested
+ * handler returns first, so it claims its own excursion before the one it
+ * preempted looks.  The CLIC_ISTACK entry stubs and the mnxti dispatcher
+ * call it for every interrupt, and CLIC_STATS_EXIT() (clic_stats.h) at the
+ * end of every compiler-made handler.  A watermark found by
+ * clic_stack_hwm() first is kept with CLIC_STACK_UNKNOWN as ID.
+ *
+ * On a stack that thread code shares with handlers, the interrupted code
+ * may have gone past the mark before the interrupt.  clic_stack_watch_entry(),
+ * called at the start of a handler from CLIC_STATS_ENTRY() and the mnxti
+ * dispatcher, claims what was written below the handler's sp for the
+ * interrupted code: CLIC_STACK_THREAD at level 0, or CLIC_STACK_UNKNOWN at
+ * the level of a preempted handler.
+ *
+ * The main stack bounds come from the freedom-metal linker script (_sp,
+ * __stack_size per hart).  The host build has no stack of its own to
+ * paint and only tracks the interrupt stack.
+ */
+
+#ifndef CLIC_STACK_H
+#define CLIC_STACK_H
+
+#include "clic_hal.h"
+
+#define CLIC_STACK_PAINT                        0x5A5AC1C5UL
+
+/* Bytes below the watermark clic_stack_watch() checks, one ABI alignment
+ * unit: a new frame stores ra in its top slot */
+#define CLIC_STACK_WATCH_BYTES                  16
+
+#define CLIC_STACK_MAIN                         0
+#define CLIC_STACK_IRQ                          1
+#define CLIC_STACK_KINDS                        2
+
+#define CLIC_STACK_UNKNOWN                      0xFFFF
+#define CLIC_STACK_THREAD                       0xFFFE
+
+typedef struct clic_stack {
+    uintptr_t base;                 /* lowest address, 0 when not tracked */
+    uintptr_t size;
+    uintptr_t low;                  /* lowest overwritten word known so far */
+    uint16_t int_id;                /* interrupt that pushed it there */
+    uint8_t level;                  /* mintstatus.mil at the time, 0 in thread code */
+} clic_stack_t;
+
+extern clic_stack_t clic_stacks[CLIC_NUM_HARTS][CLIC_STACK_KINDS];
+
+static inline clic_stack_t *clic_stack_get (unsigned hartid, unsigned kind) {
+
+    return &clic_stacks[hartid][kind];
+}
+
+/* Paint and start tracking base..base + size (the part below the live sp
+ * if it is the current stack).  Interrupts must be off. */
+void clic_stack_paint(clic_stack_t *stack, uintptr_t base, uintptr_t size);
+
+/* Paint the calling hart's stacks, called by clic_hart_init() */
+void clic_stack_init(void);
+
+/* Deepest use in bytes since painting */
+uintptr_t clic_stack_hwm(clic_stack_t *stack);
+
+/* Attribute a new watermark on the current stack to the running interrupt,
+ * with interrupts off at the end of a handler */
+void clic_stack_watch(void);
+
+/* Attribute one below the current sp to the interrupted code, with
+ * interrupts off at the start of a handler */
+void clic_stack_watch_entry(void);
+
+/* The same for a given stack and owner, if the new mark is below `below` */
+void clic_stack_account(clic_stack_t *stack, uintptr_t below, unsigned int_id, unsigned level);
+
+#endif /* CLIC_STACK_H */
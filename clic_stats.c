@@ -0,0 +1,48 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_stats.h"
+
+#if CLIC_STATS
+
+clic_stats_t clic_stats[CLIC_NUM_HARTS];
+
+/* cycles widened by clic_stats_read() */
+static uint64_t clic_stats_cycles[CLIC_NUM_HARTS][CLIC_STATS_IDS];
+
+void clic_stats_read(unsigned int_id, clic_stats_sample_t *sample) {
+
+    unsigned hart = current_hartid();
+    clic_stats_t *stats = &clic_stats[hart];
+    uint64_t *wide = &clic_stats_cycles[hart][int_id];
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+    uint32_t cycles;
+
+    /* The hooks of this hart are the only writers */
+    sample->count = stats->count[int_id];
+    cycles = stats->cycles[int_id];
+    sample->max = stats->max[int_id];
+    sample->preempted = stats->preempted[int_id];
+    *wide += (uint32_t)(cycles - (uint32_t)*wide);
+    sample->cycles = *wide;
+    clic_crit_exit(crit);
+}
+
+void clic_stats_reset(void) {
+
+    unsigned hart = current_hartid();
+    clic_stats_t *stats = &clic_stats[hart];
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+    unsigned id;
+
+    for (id = 0; id < CLIC_STATS_IDS; id++) {
+        stats->count[id] = 0;
+        stats->cycles[id] = 0;
+        clic_stats_cycles[hart][id] = 0;
+        stats->max[id] = 0;
+        stats->preempted[id] = 0;
+    }
+    clic_crit_exit(crit);
+}
+
+#endif
@@ -0,0 +1,152 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Per-interrupt statistics, built with CLIC_STATS=1.
+ *
+ * Handlers mark their first and last statement with CLIC_STATS_ENTRY() and
+ * CLIC_STATS_EXIT(), which compile to nothing otherwise.  For every ID of
+ * the vector table the calling hart's clic_stats[] keeps
+ *
+ *   count        invocations
+ *   cycles       mcycle spent from entry to exit, preemptions included,
+ *                modulo 2^32
+ *
+ * and with CLIC_HIST=1 also
+ *
+ *   max          longest single invocation, preemptions included
+ *   preempted    times a higher level interrupt came in while it ran
+ *
+ * as one array per counter, so a debugger can show one column for all
+ * IDs.  The entry hook reads mcause and mcycle, the exit hook reads mcycle
+ * and adds to count and cycles: no fence, no context block access, no
+ * branch.  max and preempted need a compare and the ID running when an
+ * interrupt preempts, kept in the hart's context block, so they come with
+ * the histograms that already pay for more.  Nothing is locked: an ID
+ * only nests into others, never into itself, so each counter has one
+ * writer per hart.
+ *
+ * The bookkeeping is left to the reader.  clic_stats_read() samples the
+ * calling hart's counters with interrupts off, so no hook runs half way,
+ * and widens cycles to 64 bits.  It has to see every ID at least once per
+ * 2^32 cycles spent in it to catch the wraps.  clic_stats_reset() starts
+ * over.  CLIC_HIST=1 adds latency and duration histograms to the same
+ * hooks (clic_hist.h), CLIC_TRACE=1 logs enter/exit records from them
+ * (clic_trace.h), and with CLIC_STACK_WATCH=1 the hooks attribute stack
+ * excursions to the interrupted code and to the handler (clic_stack.h).
+ */
+
+#ifndef CLIC_STATS_H
+#define CLIC_STATS_H
+
+#include "clic_hal.h"
+#include "clic_crit.h"
+#include "clic_hist.h"
+#include "clic_stack.h"
+#include "clic_trace.h"
+
+#define CLIC_STATS_IDS                          CLIC_VECTOR_TABLE_SIZE_MAX
+
+/* clic_ctx()->stats_active in thread code */
+#define CLIC_STATS_NONE                         0xFFFF
+
+typedef struct clic_stats {
+    uint32_t count[CLIC_STATS_IDS];
+    uint32_t cycles[CLIC_STATS_IDS];
+    uint32_t max[CLIC_STATS_IDS];
+    uint32_t preempted[CLIC_STATS_IDS];
+} clic_stats_t;
+
+extern clic_stats_t clic_stats[CLIC_NUM_HARTS];
+
+/* One ID's counters as read by clic_stats_read() */
+typedef struct clic_stats_sample {
+    uint32_t count;
+    uint32_t max;
+    uint64_t cycles;
+    uint32_t preempted;
+} clic_stats_sample_t;
+
+/* What CLIC_STATS_ENTRY() keeps for CLIC_STATS_EXIT() */
+typedef struct clic_stats_frame {
+    uint32_t start;
+    uint16_t id;
+    uint16_t prev;                  /* CLIC_HIST: the ID this one preempted */
+} clic_stats_frame_t;
+
+static inline __attribute__((always_inline)) clic_stats_frame_t clic_stats_enter (void) {
+
+    clic_stats_frame_t frame;
+
+    frame.id = (uint16_t)MCAUSE_CODE(read_csr(mcause));
+#if CLIC_TRACE
+    clic_trace_event(CLIC_TRACE_EV_ENTER, frame.id);
+#endif
+#if CLIC_STACK_WATCH && !(CLIC_ISTACK && !CLIC_HOST_MODEL)
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+
+    clic_stack_watch_entry();
+    clic_crit_exit(crit);
+#endif
+#if CLIC_STATS
+    frame.start = (uint32_t)read_csr(mcycle);
+#endif
+#if CLIC_HIST
+    clic_ctx_t *ctx = clic_ctx();
+
+    frame.prev = ctx->stats_active;
+    ctx->stats_active = frame.id;
+    if (frame.prev != CLIC_STATS_NONE)
+        clic_stats[current_hartid()].preempted[frame.prev]++;
+    clic_hist_enter(frame.id, frame.start);
+#endif
+    return frame;
+}
+
+static inline __attribute__((always_inline)) void clic_stats_leave (clic_stats_frame_t frame) {
+
+    (void)frame;
+#if CLIC_STATS
+    uint32_t elapsed = (uint32_t)read_csr(mcycle) - frame.start;
+    clic_stats_t *stats = &clic_stats[current_hartid()];
+
+    stats->cycles[frame.id] += elapsed;
+    stats->count[frame.id]++;
+#if CLIC_HIST
+    if (elapsed > stats->max[frame.id])
+        stats->max[frame.id] = elapsed;
+    clic_hist_leave(frame.id, elapsed);
+    clic_ctx()->stats_active = frame.prev;
+#endif
+#endif
+#if CLIC_TRACE
+    clic_trace_event(CLIC_TRACE_EV_EXIT, frame.id);
+#endif
+#if CLIC_STACK_WATCH && !(CLIC_ISTACK && !CLIC_HOST_MODEL)
+    /* The CLIC_ISTACK stubs do this for every handler; compiler-made
+     * handlers run their epilogue on the same stack right after */
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+
+    clic_stack_watch();
+    clic_crit_exit(crit);
+#endif
+}
+
+/* The handler hooks, for the counters, the trace (clic_trace.h) and the
+ * stack watermarks (clic_stack.h) */
+#if CLIC_STATS || CLIC_TRACE || CLIC_STACK_WATCH
+#define CLIC_STATS_ENTRY()                      clic_stats_frame_t clic_stats_frame = clic_stats_enter()
+#define CLIC_STATS_EXIT()                       clic_stats_leave(clic_stats_frame)
+#else
+#define CLIC_STATS_ENTRY()
+#define CLIC_STATS_EXIT()
+#endif
+
+/* Counters of int_id on the calling hart, from thread code.  Not
+ * reentrant, it keeps the upper half of cycles. */
+void clic_stats_read(unsigned int_id, clic_stats_sample_t *sample);
+
+/* Zero the calling hart's counters */
+void clic_stats_reset(void);
+
+#endif /* CLIC_STATS_H */
@@ -0,0 +1,103 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Exact mtime tick <-> ms/us/ns conversion.
+ *
+ * NUM_TICKS_ONE_MS truncates RTC_FREQ/1000 (32768/1000 = 32), so every
+ * millisecond computed with it is 2.3% short.  These conversions compute
+ * x * mul / div over a 96-bit intermediate, rounded to nearest (halves
+ * up), exact for every 64-bit input; results beyond 64 bits saturate to
+ * UINT64_MAX.
+ *
+ * There is no runtime division: common powers of two are cancelled out of
+ * mul/div at compile time, a power of two divisor becomes a shift, and
+ * any other divisor is handled with a compile time reciprocal and a
+ * multiply-high per 32-bit digit, plus at most two correction steps.
+ *
+ * The mtime frequency is CLIC_MTIME_FREQ, RTC_FREQ unless the build
+ * passes the BSP timebase, e.g. -DCLIC_MTIME_FREQ=1000000.  Any frequency
+ * below 2^32 Hz works.
+ */
+
+#ifndef CLIC_TIME_H
+#define CLIC_TIME_H
+
+#include <stdint.h>
+
+#ifndef CLIC_MTIME_FREQ
+#define CLIC_MTIME_FREQ                         RTC_FREQ
+#endif
+
+/* mul and div with their common factors of two removed, as constants */
+#define CLIC_TIME_CTZ_MIN(mul, div)             (__builtin_ctz(mul) < __builtin_ctz(div) ? \
+                                                 __builtin_ctz(mul) : __builtin_ctz(div))
+#define CLIC_TIME_REDUCE(v, mul, div)           ((uint32_t)((v) >> CLIC_TIME_CTZ_MIN(mul, div)))
+
+#define CLIC_TIME_SCALE(x, mul, div)            clic_time_scale((x), CLIC_TIME_REDUCE(mul, mul, div), \
+                                                                CLIC_TIME_REDUCE(div, mul, div),      \
+                                                                UINT64_MAX / CLIC_TIME_REDUCE(div, mul, div))
+
+/* High 64 bits of a 64x64 product */
+static inline __attribute__((always_inline)) uint64_t clic_time_mulhi (uint64_t a, uint64_t b) {
+
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#else
+    uint64_t al = (uint32_t)a, ah = a >> 32, bl = (uint32_t)b, bh = b >> 32;
+    uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/* One digit of long division: n / div with n < div * 2^32 */
+static inline __attribute__((always_inline)) uint64_t clic_time_divstep (uint64_t n, uint32_t div, uint64_t inv, uint32_t *rem) {
+
+    uint64_t q = clic_time_mulhi(n, inv);
+    uint64_t r = n - q * div;
+
+    /* inv = floor((2^64 - 1) / div) underestimates n / div by less than 2 */
+    while (r >= div) {
+        q++;
+        r -= div;
+    }
+    *rem = (uint32_t)r;
+    return q;
+}
+
+/* round(x * mul / div), use through CLIC_TIME_SCALE() so that mul/div are
+ * reduced and inv = (2^64 - 1) / div is folded at compile time */
+static inline __attribute__((always_inline)) uint64_t clic_time_scale (uint64_t x, uint32_t mul, uint32_t div, uint64_t inv) {
+
+    uint64_t lo = (x & 0xFFFFFFFF) * mul + (div >> 1);
+    uint64_t hi = (x >> 32) * mul + (lo >> 32);
+    uint32_t p2 = (uint32_t)(hi >> 32), p1 = (uint32_t)hi, p0 = (uint32_t)lo;
+    uint32_t r;
+    unsigned k;
+
+    if ((div & (div - 1)) == 0) {
+        k = __builtin_ctz(div);
+        if (k == 0)
+            return p2 ? UINT64_MAX : ((uint64_t)p1 << 32) | p0;
+        if (p2 >> k)
+            return UINT64_MAX;
+        return ((uint64_t)p2 << (64 - k)) | ((((uint64_t)p1 << 32) | p0) >> k);
+    }
+
+    if (clic_time_divstep(p2, div, inv, &r))
+        return UINT64_MAX;
+    hi = clic_time_divstep(((uint64_t)r << 32) | p1, div, inv, &r);
+    lo = clic_time_divstep(((uint64_t)r << 32) | p0, div, inv, &r);
+    return (hi << 32) | lo;
+}
+
+static inline uint64_t clic_ms_to_ticks (uint64_t ms) { return CLIC_TIME_SCALE(ms, CLIC_MTIME_FREQ, 1000); }
+static inline uint64_t clic_us_to_ticks (uint64_t us) { return CLIC_TIME_SCALE(us, CLIC_MTIME_FREQ, 1000000); }
+static inline uint64_t clic_ns_to_ticks (uint64_t ns) { return CLIC_TIME_SCALE(ns, CLIC_MTIME_FREQ, 1000000000); }
+static inline uint64_t clic_ticks_to_ms (uint64_t ticks) { return CLIC_TIME_SCALE(ticks, 1000, CLIC_MTIME_FREQ); }
+static inline uint64_t clic_ticks_to_us (uint64_t ticks) { return CLIC_TIME_SCALE(ticks, 1000000, CLIC_MTIME_FREQ); }
+static inline uint64_t clic_ticks_to_ns (uint64_t ticks) { return CLIC_TIME_SCALE(ticks, 1000000000, CLIC_MTIME_FREQ); }
+
+#endif /* CLIC_TIME_H */
@@ -0,0 +1,249 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_timer.h"
+#include "clic_crit.h"
+
+#define WHEEL_BITS              6
+#define WHEEL_SIZE              (1 << WHEEL_BITS)
+#define WHEEL_MASK              (WHEEL_SIZE - 1)
+#define LEVEL_SHIFT(level)      ((level) * WHEEL_BITS)
+#define OVERFLOW                CLIC_TIMER_LEVELS
+
+/* Shared by timer_handler and whoever starts/cancels timers, updated in
+ * CLIC_CRIT_ALL sections */
+static struct {
+    uint64_t now;               /* every slot before this time has been processed */
+    uint64_t occupied[CLIC_TIMER_LEVELS];
+    clic_timer_t *slot[CLIC_TIMER_LEVELS][WHEEL_SIZE];
+    clic_timer_t *overflow;
+} wheel;
+
+/* The armed deadline lives with mtimecmp in the hart's context block */
+static void arm(uint64_t when) {
+
+    clic_ctx_t *ctx = clic_ctx();
+
+    ctx->timer_armed = when;
+    write_mtimecmp(ctx->mtimecmp, when);
+}
+
+static void wheel_link(clic_timer_t **head, clic_timer_t *timer) {
+
+    timer->next = *head;
+    if (timer->next)
+        timer->next->pprev = &timer->next;
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void wheel_unlink(clic_timer_t *timer) {
+
+    *timer->pprev = timer->next;
+    if (timer->next)
+        timer->next->pprev = timer->pprev;
+    if (timer->level != OVERFLOW && !wheel.slot[timer->level][timer->slot])
+        wheel.occupied[timer->level] &= ~(1ULL << timer->slot);
+    timer->pprev = NULL;
+}
+
+/* The level is the one of the highest bit in which the deadline differs
+ * from wheel.now, so every timer on level L shares now's bits above it and
+ * sits in a later slot than now (or in now's own slot on level 0) */
+static void place(clic_timer_t *timer) {
+
+    uint64_t when = timer->expires > wheel.now ? timer->expires : wheel.now;
+    uint64_t diff = when ^ wheel.now;
+    unsigned level = diff ? (63 - __builtin_clzll(diff)) / WHEEL_BITS : 0;
+
+    if (level >= CLIC_TIMER_LEVELS) {
+        timer->level = OVERFLOW;
+        wheel_link(&wheel.overflow, timer);
+        return;
+    }
+    timer->level = level;
+    timer->slot = (when >> LEVEL_SHIFT(level)) & WHEEL_MASK;
+    wheel_link(&wheel.slot[level][timer->slot], timer);
+    wheel.occupied[level] |= 1ULL << timer->slot;
+}
+
+/* Time of the next slot to process, and its level.  Everything on a lower
+ * level expires before anything on a higher one. */
+static uint64_t next_slot(unsigned *level) {
+
+    uint64_t block;
+    unsigned l;
+
+    for (l = 0; l < CLIC_TIMER_LEVELS; l++) {
+        if (wheel.occupied[l]) {
+            block = wheel.now & ~((1ULL << LEVEL_SHIFT(l + 1)) - 1);
+            *level = l;
+            return block + ((uint64_t)__builtin_ctzll(wheel.occupied[l]) << LEVEL_SHIFT(l));
+        }
+    }
+    *level = OVERFLOW;
+    if (wheel.overflow)
+        return (wheel.now | ((1ULL << LEVEL_SHIFT(CLIC_TIMER_LEVELS)) - 1)) + 1;
+    return UINT64_MAX;
+}
+
+void clic_timer_reset(uint64_t now) {
+
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+    unsigned l, s;
+
+    for (l = 0; l < CLIC_TIMER_LEVELS; l++) {
+        for (s = 0; s < WHEEL_SIZE; s++)
+            while (wheel.slot[l][s])
+                wheel_unlink(wheel.slot[l][s]);
+    }
+    while (wheel.overflow)
+        wheel_unlink(wheel.overflow);
+    wheel.now = now;
+    clic_crit_exit(crit);
+}
+
+void clic_timer_init(void) {
+
+    clic_timer_reset(clic_timer_now());
+    arm(UINT64_MAX);
+}
+
+void clic_timer_start(clic_timer_t *timer, uint64_t expires) {
+
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+
+    if (timer->pprev)
+        wheel_unlink(timer);
+    /* Nothing to keep in step with, restart the wheel at the present */
+    if (!wheel.overflow && clic_ctx()->timer_armed == UINT64_MAX)
+        wheel.now = clic_timer_now();
+    timer->expires = expires;
+    place(timer);
+    if (expires < clic_ctx()->timer_armed)
+        arm(expires > wheel.now ? expires : wheel.now);
+    clic_crit_exit(crit);
+}
+
+int clic_timer_cancel(clic_timer_t *timer) {
+
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+    int pending = timer->pprev != NULL;
+
+    /* mtimecmp is left alone, an early interrupt just finds nothing due */
+    if (pending)
+        wheel_unlink(timer);
+    clic_crit_exit(crit);
+    return pending;
+}
+
+uint64_t clic_timer_process(uint64_t now) {
+
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+    clic_timer_t *timer, *list;
+    uint64_t next, first;
+    unsigned level;
+
+    while ((next = next_slot(&level)) <= now) {
+        if (level == OVERFLOW) {
+            /* Rare: jump straight to the earliest far deadline (or to the
+             * present) instead of walking the empty blocks in between */
+            first = now;
+            for (timer = wheel.overflow; timer; timer = timer->next)
+                if (timer->expires < first)
+                    first = timer->expires;
+            wheel.now = first > next ? first : next;
+            list = wheel.overflow;
+            wheel.overflow = NULL;
+        } else {
+            wheel.now = next;
+            list = wheel.slot[level][(next >> LEVEL_SHIFT(level)) & WHEEL_MASK];
+            wheel.slot[level][(next >> LEVEL_SHIFT(level)) & WHEEL_MASK] = NULL;
+            wheel.occupied[level] &= ~(1ULL << ((next >> LEVEL_SHIFT(level)) & WHEEL_MASK));
+        }
+
+        while ((timer = list) != NULL) {
+            list = timer->next;
+            if (list)
+                list->pprev = &list;
+            timer->pprev = NULL;
+
+            if (level != 0) {
+                /* Cascade to a lower level, relative to the new now */
+                place(timer);
+                continue;
+            }
+            /* Callbacks run with the threshold as it was on entry */
+            clic_crit_exit(crit);
+            timer->fn(timer);
+            crit = clic_crit_enter(CLIC_CRIT_ALL);
+        }
+    }
+
+    /* Nothing left, the wheel can move on to the present */
+    if (next == UINT64_MAX)
+        wheel.now = now;
+    clic_crit_exit(crit);
+    return next;
+}
+
+void clic_timer_run(void) {
+
+    clic_crit_t crit;
+    uint64_t next;
+    unsigned level;
+
+    do {
+        clic_timer_process(clic_timer_now());
+        /* Arm inside the section: a timer started from a preempting handler
+         * since process() returned may be due first, and on RV32 its
+         * mtimecmp write must not interleave with this one */
+        crit = clic_crit_enter(CLIC_CRIT_ALL);
+        next = next_slot(&level);
+        arm(next);
+        clic_crit_exit(crit);
+        /* Callbacks took long enough for the next slot to be due */
+    } while (next <= clic_timer_now());
+}
+
+void clic_periodic_reset_stats(clic_periodic_t *periodic) {
+
+    periodic->periods = 0;
+    periodic->missed = 0;
+    periodic->jitter_min = UINT32_MAX;
+    periodic->jitter_max = 0;
+    periodic->jitter_sum = 0;
+}
+
+void clic_periodic_start(clic_periodic_t *periodic, uint64_t first, uint64_t period) {
+
+    periodic->timer.fn = clic_periodic_expired;
+    periodic->period = period ? period : 1;
+    clic_timer_start(&periodic->timer, first);
+}
+
+void clic_periodic_expired(clic_timer_t *timer) {
+
+    clic_periodic_t *periodic = (clic_periodic_t *)((char *)timer - offsetof(clic_periodic_t, timer));
+    uint64_t deadline = timer->expires;
+    uint64_t late = clic_timer_now() - deadline;
+    uint64_t skipped = 0;
+    uint32_t jitter = late > UINT32_MAX ? UINT32_MAX : (uint32_t)late;
+
+    /* Deadlines strictly before now, the 64-bit division (a libgcc call on
+     * RV32) only when there is at least one */
+    if (late > periodic->period)
+        skipped = (late - 1) / periodic->period;
+
+    periodic->periods++;
+    periodic->missed += (uint32_t)skipped;
+    periodic->jitter_sum += jitter;
+    if (jitter < periodic->jitter_min)
+        periodic->jitter_min = jitter;
+    if (jitter > periodic->jitter_max)
+        periodic->jitter_max = jitter;
+
+    /* Re-arm on the grid first, so the callback may stop or restart it */
+    clic_timer_start(timer, deadline + (skipped + 1) * periodic->period);
+    periodic->fn(periodic);
+}
@@ -0,0 +1,125 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Software timers multiplexed on the single mtimecmp comparator of a hart.
+ *
+ * Timers live in a hierarchical timing wheel: CLIC_TIMER_LEVELS levels of
+ * 64 slots, level L holding timers that expire within the current 64^(L+1)
+ * tick block, and an overflow list beyond that.  Start and cancel are O(1)
+ * (a list link and a bitmap bit); the earliest occupied slot is found with
+ * a count-trailing-zeros on the lowest non-empty level's bitmap.
+ *
+ * mtimecmp is always armed at the next slot to process: the earliest
+ * deadline when it is on level 0, or the point where a higher level slot
+ * has to be cascaded down (at most CLIC_TIMER_LEVELS extra interrupts for
+ * a far deadline).  timer_handler calls clic_timer_run(), which expires
+ * every timer that is due in one go and re-arms the comparator; with no
+ * timer left mtimecmp is parked at the maximum.
+ *
+ *   static void blink (clic_timer_t *t) { ... clic_timer_start(t, t->expires + period); }
+ *   static clic_timer_t led = CLIC_TIMER_INIT(blink);
+ *
+ *   clic_timer_start(&led, clic_timer_now() + clic_ms_to_ticks(1000));
+ *
+ * Times are absolute mtime ticks.  Callbacks run from timer_handler with
+ * interrupts enabled and may start or cancel any timer.  There is one
+ * wheel, owned by the boot hart: start and cancel timers from there only.
+ */
+
+#ifndef CLIC_TIMER_H
+#define CLIC_TIMER_H
+
+#include <stddef.h>
+
+#include "clic_hal.h"
+
+/* 6 bits per level, 4 levels cover 2^24 ticks (512s at 32768Hz) */
+#ifndef CLIC_TIMER_LEVELS
+#define CLIC_TIMER_LEVELS                       4
+#endif
+
+typedef struct clic_timer {
+    struct clic_timer *next;
+    struct clic_timer **pprev;          /* NULL when not pending */
+    uint64_t expires;
+    void (*fn)(struct clic_timer *timer);
+    uint8_t level;
+    uint8_t slot;
+} clic_timer_t;
+
+#define CLIC_TIMER_INIT(fn)                     { NULL, NULL, 0, (fn), 0, 0 }
+
+static inline uint64_t clic_timer_now (void) {
+
+    return read_mtime();
+}
+
+static inline int clic_timer_pending (const clic_timer_t *timer) {
+
+    return timer->pprev != NULL;
+}
+
+/* Empty the wheel, start counting from mtime and park mtimecmp.  Call
+ * before the timer interrupt is enabled. */
+void clic_timer_init(void);
+
+/* (Re)start a timer to fire once mtime >= expires */
+void clic_timer_start(clic_timer_t *timer, uint64_t expires);
+
+/* Returns 1 if the timer was pending */
+int clic_timer_cancel(clic_timer_t *timer);
+
+/* Expire everything due at mtime and re-arm mtimecmp, from timer_handler */
+void clic_timer_run(void);
+
+/* Expire everything due at 'now' without touching mtime/mtimecmp, and
+ * return the time of the next slot to process (UINT64_MAX if none).
+ * clic_timer_run() is built on it; the benchmark drives it directly. */
+uint64_t clic_timer_process(uint64_t now);
+
+/* Empty the wheel and restart it at 'now', without touching mtimecmp */
+void clic_timer_reset(uint64_t now);
+
+/*
+ * Periodic timers.  Each deadline is the previous deadline plus the period,
+ * never "mtime when the handler ran" plus the period, so handler latency
+ * does not accumulate into drift.  When a deadline is found more than a
+ * period late the grid deadlines already in the past are skipped, counted
+ * in 'missed', and the timer resumes on the original grid.  Exactly one
+ * period late is not a miss: the next deadline is due right away and
+ * runs.  Every run records its lateness (mtime at the callback minus the
+ * deadline) as jitter, in mtime ticks.
+ *
+ *   static void control_loop (clic_periodic_t *p) { ... }
+ *   static clic_periodic_t loop = CLIC_PERIODIC_INIT(control_loop);
+ *
+ *   clic_periodic_start(&loop, clic_timer_now() + clic_ms_to_ticks(1), clic_ms_to_ticks(1));
+ */
+typedef struct clic_periodic {
+    clic_timer_t timer;
+    uint64_t period;
+    void (*fn)(struct clic_periodic *periodic);
+    uint32_t periods;                   /* callbacks run */
+    uint32_t missed;                    /* deadlines skipped */
+    uint32_t jitter_min;
+    uint32_t jitter_max;
+    uint64_t jitter_sum;
+} clic_periodic_t;
+
+void clic_periodic_expired(clic_timer_t *timer);
+
+#define CLIC_PERIODIC_INIT(fn)                  { CLIC_TIMER_INIT(clic_periodic_expired), 0, (fn), 0, 0, UINT32_MAX, 0, 0 }
+
+/* First deadline at 'first', then every 'period' ticks after it */
+void clic_periodic_start(clic_periodic_t *periodic, uint64_t first, uint64_t period);
+
+static inline void clic_periodic_stop (clic_periodic_t *periodic) {
+
+    clic_timer_cancel(&periodic->timer);
+}
+
+/* Clear periods/missed/jitter, e.g. after reading them out */
+void clic_periodic_reset_stats(clic_periodic_t *periodic);
+
+#endif /* CLIC_TIMER_H */
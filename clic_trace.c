@@ -0,0 +1,33 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clic_trace.h"
+
+#if CLIC_TRACE
+
+_Static_assert((CLIC_TRACE_DEPTH & (CLIC_TRACE_DEPTH - 1)) == 0, "CLIC_TRACE_DEPTH must be a power of two");
+_Static_assert(sizeof(clic_trace_rec_t) == 8, "trace records are 8 bytes");
+
+clic_trace_t clic_trace[CLIC_NUM_HARTS];
+
+void clic_trace_start(unsigned mode) {
+
+    clic_trace_t *trace = &clic_trace[current_hartid()];
+    clic_crit_t crit = clic_crit_enter(CLIC_CRIT_ALL);
+
+    trace->magic = CLIC_TRACE_MAGIC;
+    trace->head = 0;
+    trace->depth = CLIC_TRACE_DEPTH;
+    trace->last = (uint32_t)read_csr(mcycle);
+    trace->dropped = 0;
+    trace->hartid = current_hartid();
+    trace->mode = mode;
+    clic_crit_exit(crit);
+}
+
+void clic_trace_stop(void) {
+
+    clic_trace[current_hartid()].mode = CLIC_TRACE_OFF;
+}
+
+#endif
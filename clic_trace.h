@@ -0,0 +1,123 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Binary interrupt trace, built with CLIC_TRACE=1.
+ *
+ * Each hart logs 8-byte records into its clic_trace buffer:
+ *
+ *   delta      mcycle since the hart's previous record
+ *   type       enter, exit, pend or exception
+ *   level      mintstatus.mil when it was logged
+ *   id         CLIC interrupt ID (exception: mcause code)
+ *
+ * Enter and exit come from the CLIC_STATS_ENTRY()/CLIC_STATS_EXIT() hooks
+ * of the handlers, pend from CLIC_TRACE_PEND() next to the writes that
+ * pend #12 in clic_defer() and MSIP in clic_mbox_send() (ID 3 on the
+ * sending hart), and exception from the crash capture (clic_crash.h).
+ * Nested preemptions show up as properly nested enter/exit pairs.
+ *
+ * clic_trace_start(CLIC_TRACE_FLIGHT) keeps the newest CLIC_TRACE_DEPTH
+ * records, overwriting the oldest; CLIC_TRACE_ONESHOT stops when the
+ * buffer is full and counts what it dropped.  Nothing is logged before
+ * clic_trace_start() or after clic_trace_stop().
+ *
+ * tools/clic_trace_decode turns a memory dump of clic_trace into Chrome
+ * trace JSON (chrome://tracing, Perfetto):
+ *
+ *   (gdb) dump binary value trace.bin clic_trace
+ *   $ tools/clic_trace_decode -f 32000000 trace.bin > trace.json
+ */
+
+#ifndef CLIC_TRACE_H
+#define CLIC_TRACE_H
+
+#include "clic_hal.h"
+#include "clic_crit.h"
+
+/* Records per hart, a power of two */
+#ifndef CLIC_TRACE_DEPTH
+#define CLIC_TRACE_DEPTH                        256
+#endif
+
+#define CLIC_TRACE_MAGIC                        0xC1C07ACEUL
+
+#define CLIC_TRACE_EV_ENTER                     1
+#define CLIC_TRACE_EV_EXIT                      2
+#define CLIC_TRACE_EV_PEND                      3
+#define CLIC_TRACE_EV_EXCEPTION                 4
+
+#define CLIC_TRACE_OFF                          0
+#define CLIC_TRACE_FLIGHT                       1
+#define CLIC_TRACE_ONESHOT                      2
+
+typedef struct clic_trace_rec {
+    uint32_t delta;
+    uint8_t type;
+    uint8_t level;
+    uint16_t id;
+} clic_trace_rec_t;
+
+/* Layout shared with tools/clic_trace_decode.c: a 32-byte header, then
+ * the records, little endian */
+typedef struct clic_trace {
+    uint32_t magic;
+    uint32_t mode;
+    uint32_t head;                  /* records logged since clic_trace_start() */
+    uint32_t depth;
+    uint32_t last;                  /* mcycle of the newest record */
+    uint32_t dropped;               /* CLIC_TRACE_ONESHOT: records that did not fit */
+    uint32_t hartid;
+    uint32_t reserved;
+    clic_trace_rec_t rec[CLIC_TRACE_DEPTH];
+} clic_trace_t;
+
+extern clic_trace_t clic_trace[CLIC_NUM_HARTS];
+
+/* Log into a given hart's buffer, for callers that cannot trust tp */
+static inline __attribute__((always_inline)) void clic_trace_log (clic_trace_t *trace, unsigned type, unsigned id) {
+
+    clic_crit_t crit;
+    clic_trace_rec_t *rec;
+    uint32_t now;
+
+    if (trace->mode == CLIC_TRACE_OFF)
+        return;
+
+    /* A preempting handler would take the same slot and delta base */
+    crit = clic_crit_enter(CLIC_CRIT_ALL);
+    if (trace->mode == CLIC_TRACE_ONESHOT && trace->head >= CLIC_TRACE_DEPTH) {
+        trace->dropped++;
+    } else {
+        now = (uint32_t)read_csr(mcycle);
+        rec = &trace->rec[trace->head & (CLIC_TRACE_DEPTH - 1)];
+        rec->delta = now - trace->last;
+        rec->type = (uint8_t)type;
+        rec->level = (uint8_t)MINTSTATUS_MIL(read_csr(0x346));     /* 0x346 is mintstatus */
+        rec->id = (uint16_t)id;
+        trace->last = now;
+        trace->head++;
+    }
+    clic_crit_exit(crit);
+}
+
+static inline __attribute__((always_inline)) void clic_trace_event (unsigned type, unsigned id) {
+
+    clic_trace_log(&clic_trace[current_hartid()], type, id);
+}
+
+/* Log a pend of int_id on the calling hart, next to the clicintip or MSIP
+ * write that does it; nothing without CLIC_TRACE */
+#if CLIC_TRACE
+#define CLIC_TRACE_PEND(int_id)                 clic_trace_event(CLIC_TRACE_EV_PEND, int_id)
+#else
+#define CLIC_TRACE_PEND(int_id)                 do { } while (0)
+#endif
+
+/* Start logging on the calling hart from an empty buffer */
+void clic_trace_start(unsigned mode);
+
+/* Stop logging on the calling hart, the buffer is kept for the decoder */
+void clic_trace_stop(void);
+
+#endif /* CLIC_TRACE_H */
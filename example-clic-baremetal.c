@@ -11,14 +11,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-/* These includes get created at build time, and are based on the contents
- * in the bsp folder.  They are useful since they allow us
- * to use auto generated symbols and base addresses which may change
- * based on the design, and every design has it's own unique bsp.
+/* clic_hal.h pulls in the metal includes that get created at build time,
+ * and are based on the contents in the bsp folder.  They are useful since
+ * they allow us to use auto generated symbols and base addresses which may
+ * change based on the design, and every design has it's own unique bsp.
  */
-#include <metal/machine.h>
-#include <metal/machine/platform.h>
-#include <metal/machine/inline.h>
+#include "clic_hal.h"
+#include "clic_bench.h"
+#include "clic_irq.h"
+#include "clic_nxti.h"
+#include "clic_ring.h"
+#include "clic_defer.h"
+#include "clic_timer.h"
+#include "clic_mbox.h"
+#include "clic_crash.h"
+#include "clic_stats.h"
+#include "clic_prof.h"
+#include "clic_poll.h"
 
 /*
  * This test demonstrates how to enable and handle local interrupts,
@@ -37,149 +46,178 @@
  * in this example.
  */
 
-#define DISABLE                 0
-#define ENABLE                  1
-#define TRUE                    1
-#define FALSE                   0
-#define INPUT                   0x100    /* something other than 0 or 1 */
-#define OUTPUT                  0x101    /* something other than 0 or 1 */
-#define RTC_FREQ                32768
-
-#define MCAUSE_INTR                         0x80000000UL
-#define MCAUSE_CAUSE                        0x000003FFUL
-#define MCAUSE_CODE(cause)                  (cause & MCAUSE_CAUSE)
-
-/* Compile time options to determine which interrupt modules we have */
-#define CLIC_PRESENT                            (METAL_MAX_CLIC_INTERRUPTS > 0)
-#define PLIC_PRESENT                            (METAL_MAX_PLIC_INTERRUPTS > 0)
-
-/* Interrupt Specific defines - used for mtvec.mode field, which is bit[0] for
- * designs with CLINT, or [1:0] for designs with a CLIC */
-#define MTVEC_MODE_CLINT_DIRECT                 0x00
-#define MTVEC_MODE_CLINT_VECTORED               0x01
-#define MTVEC_MODE_CLIC_DIRECT                  0x02
-#define MTVEC_MODE_CLIC_VECTORED                0x03
-
-/* Offsets for multi-core systems */
-#define MSIP_PER_HART_OFFSET                             0x4
-#define MTIMECMP_PER_HART_OFFSET                         0x8
-
-#if CLIC_PRESENT
-#define CLIC_BASE_ADDR                                  METAL_SIFIVE_CLIC0_0_BASE_ADDRESS
-#define MSIP_BASE_ADDR(hartid)                          (CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_MSIP_BASE + (hartid * MSIP_PER_HART_OFFSET))
-#define MTIMECMP_BASE_ADDR(hartid)                      (CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_MTIMECMP_BASE + (hartid * MTIMECMP_PER_HART_OFFSET))
-#define MTIME_BASE_ADDR                                 (CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_MTIME)
-#define HART0_CLIC_OFFSET                               0x00800000
-#define HART0_CLIC_BASE_ADDR                            (CLIC_BASE_ADDR + HART0_CLIC_OFFSET)
-#define HART0_CLICINTIP_ADDR(int_num)                   (HART0_CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_CLICINTIP_BASE + int_num)   /* one byte per enable */
-#define HART0_CLICINTIE_ADDR(int_num)                   (HART0_CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_CLICINTIE_BASE + int_num)   /* one byte per enable */
-#define HART0_CLICINTCFG_ADDR(int_num)                  (HART0_CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_CLICINTCTL_BASE + int_num)   /* one byte per enable */
-#define HART0_CLICCFG_ADDR                              (HART0_CLIC_BASE_ADDR + METAL_SIFIVE_CLIC0_CLICCFG)   /* one byte per CLIC */
-#define CLICCFG_NVBITS(x)                               ((x & 1) << 0)
-#define CLICCFG_NLBITS(x)                               ((x & 0xF) << 1)
-#define CLICCFG_NMBITS(x)                               ((x & 0x3) << 5)
-#define INT_ID_SOFTWARE                                 3
-#define INT_ID_TIMER                                    7
-#define INT_ID_EXTERNAL                                 11
-#define INT_ID_CLIC_SOFTWARE                            12
-#define MAX_LOCAL_INTS                                  16  /* local interrupts, not local external interrupts */
-#define CLIC_VECTOR_TABLE_SIZE_MAX                      METAL_SIFIVE_CLIC0_2000000_SIFIVE_NUMINTS
-#define SOFTWARE_INT_ENABLE                             write_byte(HART0_CLICINTIE_ADDR(INT_ID_SOFTWARE), ENABLE);
-#define SOFTWARE_INT_DISABLE                            write_byte(HART0_CLICINTIE_ADDR(INT_ID_SOFTWARE), DISABLE);
-#define TIMER_INT_ENABLE                                write_byte(HART0_CLICINTIE_ADDR(INT_ID_TIMER), ENABLE);
-#define TIMER_INT_DISABLE                               write_byte(HART0_CLICINTIE_ADDR(INT_ID_TIMER), DISABLE);
-#define EXTERNAL_INT_ENABLE                             write_byte(HART0_CLICINTIE_ADDR(INT_ID_EXTERNAL), ENABLE);
-#define EXTERNAL_INT_EDISABLE                           write_byte(HART0_CLICINTIE_ADDR(INT_ID_EXTERNAL), DISABLE);
-#define CLIC_SOFTWARE_INT_ENABLE                        write_byte(HART0_CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), ENABLE);
-#define CLIC_SOFTWARE_INT_DISABLE                       write_byte(HART0_CLICINTIE_ADDR(INT_ID_CLIC_SOFTWARE), DISABLE);
-#define CLIC_SOFTWARE_INT_SET                           write_byte(HART0_CLICINTIP_ADDR(INT_ID_CLIC_SOFTWARE), ENABLE);
-#define CLIC_SOFTWARE_INT_CLEAR                         write_byte(HART0_CLICINTIP_ADDR(INT_ID_CLIC_SOFTWARE), DISABLE);
-#else
-#error "This design does not have a CLIC...Exiting.\n");
-#endif
-
-#define NUM_TICKS_ONE_S                         RTC_FREQ            // it takes this many ticks of mtime for 1s to elapse
-#define NUM_TICKS_ONE_MS                        (RTC_FREQ/1000)     // it takes this many ticks of mtime for 1ms to elapse
 #define DEMO_TIMER_INTERVAL                     5000                // 5s timer interval
-#define SET_TIMER_INTERVAL_MS(ms_ticks)         write_dword(MTIMECMP_BASE_ADDR(read_csr(mhartid)), (read_dword(MTIME_BASE_ADDR) + (ms_ticks * NUM_TICKS_ONE_MS)))
-
-inline __attribute__((always_inline)) void interrupt_global_enable (void) {
-    uintptr_t m;
-    __asm__ volatile ("csrrs %0, mstatus, %1" : "=r"(m) : "r"(METAL_MIE_INTERRUPT));
-}
-
-inline __attribute__((always_inline)) void interrupt_global_disable (void) {
-    uintptr_t m;
-    __asm__ volatile ("csrrc %0, mstatus, %1" : "=r"(m) : "r"(METAL_MIE_INTERRUPT));
-}
-
-/* Defines to access CSR registers within C code */
-#define read_csr(reg) ({ unsigned long __tmp; \
-  asm volatile ("csrr %0, " #reg : "=r"(__tmp)); \
-  __tmp; })
-
-#define write_csr(reg, val) ({ \
-  asm volatile ("csrw " #reg ", %0" :: "rK"(val)); })
-
-#define write_dword(addr, data)                 ((*(volatile uint64_t *)(addr)) = data)
-#define read_dword(addr)                        (*(volatile uint64_t *)(addr))
-#define write_word(addr, data)                  ((*(volatile uint32_t *)(addr)) = data)
-#define read_word(addr)                         (*(volatile uint32_t *)(addr))
-#define write_byte(addr, data)                  ((*(volatile uint8_t *)(addr)) = data)
-#define read_byte(addr)                         (*(volatile uint8_t *)(addr))
 
 /* Globals */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) software_handler (void);
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) clic_software_handler (void);
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) timer_handler (void);
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) external_handler (void);
-void __attribute__((weak, interrupt, aligned(64))) default_exception_handler(void);
-
-__attribute__((aligned(64))) uintptr_t __mtvt_clic_vector_table[CLIC_VECTOR_TABLE_SIZE_MAX];
-
-/* user interrupt handler */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc0_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) software_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) clic_software_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) timer_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) external_handler (void);
+void __attribute__((weak, CLIC_CRASH_HANDLER, aligned(64))) default_exception_handler(void);
+
+/* user interrupt handlers */
+void __attribute__((weak, CLIC_HANDLER)) lc0_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc1_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc2_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc3_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc4_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc5_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc6_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc7_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc8_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc9_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc10_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc11_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc12_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc13_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc14_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc15_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc16_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc17_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc18_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc19_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc20_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc21_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc22_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc23_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc24_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc25_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc26_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc27_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc28_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc29_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc30_handler (void);
+void __attribute__((weak, CLIC_HANDLER)) lc31_handler (void);
+
+/* IRQ map - one line per interrupt to bring up:
+ *   IRQ(int_id, level, priority, shv, trigger, handler)
+ * The map builds the vector table at compile time (IDs not listed vector to
+ * default_exception_handler) and the table clic_irq_register() applies in
+ * main().  See the clicintcfg notes in main() for how level and priority
+ * are encoded.  With CLIC_NXTI_DISPATCH=1, lines with shv = 0 are drained
+ * by clic_nxti_dispatch() and take a plain function as handler.
+ * Ready made lines:
+ *
+ *   IRQ(INT_ID_EXTERNAL,      255, 255, 1, CLIC_TRIGGER_LEVEL, external_handler)
+ *   LOCAL_EXT_IRQ_MAP(IRQ, 255, 255)      local external lines 18-47
+ */
+#define CLIC_IRQ_MAP(IRQ)                                                       \
+    IRQ(INT_ID_CLIC_SOFTWARE,   0,   0, 1, CLIC_TRIGGER_LEVEL, clic_software_handler) /* deferred work */ \
+    IRQ(INT_ID_TIMER,         255, 255, 1, CLIC_TRIGGER_LEVEL, timer_handler)         /* software timers */ \
+    IRQ(INT_ID_SOFTWARE,      255, 255, 1, CLIC_TRIGGER_LEVEL, software_handler)      /* inter-hart mailbox */ \
+    IRQ(16, 255, 255, 1, CLIC_TRIGGER_LEVEL, lc0_handler)   /* local_ext_irq0 */ \
+    IRQ(17, 255, 255, 1, CLIC_TRIGGER_LEVEL, lc1_handler)   /* local_ext_irq1, polled when busy */
+
+/* local_ext_irq2-31 on IDs 18-47, all at one level and priority; 16 and
+ * 17 are already in CLIC_IRQ_MAP */
+#define LOCAL_EXT_IRQ_MAP(IRQ, level, priority)                                 \
+    IRQ(18, level, priority, 1, CLIC_TRIGGER_LEVEL, lc2_handler) \
+    IRQ(19, level, priority, 1, CLIC_TRIGGER_LEVEL, lc3_handler) \
+    IRQ(20, level, priority, 1, CLIC_TRIGGER_LEVEL, lc4_handler) \
+    IRQ(21, level, priority, 1, CLIC_TRIGGER_LEVEL, lc5_handler) \
+    IRQ(22, level, priority, 1, CLIC_TRIGGER_LEVEL, lc6_handler) \
+    IRQ(23, level, priority, 1, CLIC_TRIGGER_LEVEL, lc7_handler) \
+    IRQ(24, level, priority, 1, CLIC_TRIGGER_LEVEL, lc8_handler) \
+    IRQ(25, level, priority, 1, CLIC_TRIGGER_LEVEL, lc9_handler) \
+    IRQ(26, level, priority, 1, CLIC_TRIGGER_LEVEL, lc10_handler) \
+    IRQ(27, level, priority, 1, CLIC_TRIGGER_LEVEL, lc11_handler) \
+    IRQ(28, level, priority, 1, CLIC_TRIGGER_LEVEL, lc12_handler) \
+    IRQ(29, level, priority, 1, CLIC_TRIGGER_LEVEL, lc13_handler) \
+    IRQ(30, level, priority, 1, CLIC_TRIGGER_LEVEL, lc14_handler) \
+    IRQ(31, level, priority, 1, CLIC_TRIGGER_LEVEL, lc15_handler) \
+    IRQ(32, level, priority, 1, CLIC_TRIGGER_LEVEL, lc16_handler) \
+    IRQ(33, level, priority, 1, CLIC_TRIGGER_LEVEL, lc17_handler) \
+    IRQ(34, level, priority, 1, CLIC_TRIGGER_LEVEL, lc18_handler) \
+    IRQ(35, level, priority, 1, CLIC_TRIGGER_LEVEL, lc19_handler) \
+    IRQ(36, level, priority, 1, CLIC_TRIGGER_LEVEL, lc20_handler) \
+    IRQ(37, level, priority, 1, CLIC_TRIGGER_LEVEL, lc21_handler) \
+    IRQ(38, level, priority, 1, CLIC_TRIGGER_LEVEL, lc22_handler) \
+    IRQ(39, level, priority, 1, CLIC_TRIGGER_LEVEL, lc23_handler) \
+    IRQ(40, level, priority, 1, CLIC_TRIGGER_LEVEL, lc24_handler) \
+    IRQ(41, level, priority, 1, CLIC_TRIGGER_LEVEL, lc25_handler) \
+    IRQ(42, level, priority, 1, CLIC_TRIGGER_LEVEL, lc26_handler) \
+    IRQ(43, level, priority, 1, CLIC_TRIGGER_LEVEL, lc27_handler) \
+    IRQ(44, level, priority, 1, CLIC_TRIGGER_LEVEL, lc28_handler) \
+    IRQ(45, level, priority, 1, CLIC_TRIGGER_LEVEL, lc29_handler) \
+    IRQ(46, level, priority, 1, CLIC_TRIGGER_LEVEL, lc30_handler) \
+    IRQ(47, level, priority, 1, CLIC_TRIGGER_LEVEL, lc31_handler)
+
+CLIC_DEFINE_VECTOR_TABLE(CLIC_IRQ_MAP);
+
+static const clic_irq_t irq_table[] = {
+    CLIC_IRQ_MAP(CLIC_IRQ_ENTRY)
+};
+
+/* mcycle count of the clic_irq_register() call, for the debugger */
+volatile uint32_t irq_setup_cycles;
+
+/* Events handed from the local external handlers to the main loop */
+struct lc_event {
+    uint32_t int_id;
+    uint32_t mcycle;
+};
+
+CLIC_RING_DEFINE(lc_event_ring, struct lc_event, 16);
+
+static lc_event_ring_t lc_events;
+
+#if !CLIC_BENCHMARK
+/* Software timer started in main(), runs from timer_handler */
+static void demo_timer_expired (clic_timer_t *timer) {
+
+    /* Just Do Something when the timer is expired, or restart it */
+}
+
+static clic_timer_t demo_timer = CLIC_TIMER_INIT(demo_timer_expired);
+
+/* Sent from main(), runs from software_handler on the receiving hart */
+static void demo_mbox_message (unsigned from, uintptr_t arg) {
+
+    /* Do Something on behalf of hart `from` */
+}
+#endif
 
 /* you can activate what you want to test */
-#define ACTIVATE_SOFTWARE_INTERRUPT         0
-#define ACTIVATE_CLIC_SOFTWARE_INTERRUPT    0
-#define ACTIVATE_TIMER_INTERRUPT            0
-#define ACTIVATE_EXTERNAL_INTERRUPT         0
 #define ACTIVATE_NESTED_INTERRUPT           0
-#define ACTIVATE_LOCAL_EXT_INTERRUPT        1
 
 /* Main - Setup CLIC interrupt handling and describe how to trigger interrupt */
 int main() {
 
-    uint32_t i, mode = MTVEC_MODE_CLIC_VECTORED;
-    uintptr_t mtvec_base, mtvt_base;
-    uint8_t cliccfg, clicintcfg;
+    clic_hart_t hart = {
+        .mtvt = __mtvt_clic_vector_table,
+        .irqs = irq_table,
+        .count = sizeof(irq_table) / sizeof(irq_table[0]),
+    };
 
     /* Write mstatus.mie = 0 to disable all machine interrupts prior to setup */
     interrupt_global_disable();
 
+    /* Point tp at this hart's context block before anything uses it */
+    clic_ctx_init();
+
+    /* Faults recorded before the last reset, for tools/clic_crash_decode */
+    clic_crash_dump();
+
     /* Setup mtvec to point to our exception handler table using mtvec.base,
-     * and assign mtvec.mode = 3 for CLIC vectored mode of operation. The
-     * mtvec.mode field is bit[0] for designs with CLINT, or [1:0] using CLIC */
-    mtvec_base = (uintptr_t)&default_exception_handler;
-    write_csr (mtvec, (mtvec_base | mode));
-
-    /* Setup mtvt which is CLIC specific, to hold base address for interrupt handlers */
-    mtvt_base = (uintptr_t)&__mtvt_clic_vector_table;
-    write_csr (0x307, (mtvt_base));  /* 0x307 is CLIC CSR number */
-
-    for (int i = 0; i < CLIC_VECTOR_TABLE_SIZE_MAX; i++)
-    {
-        __mtvt_clic_vector_table[i] = (uintptr_t)&default_exception_handler;
-    }
+     * clic_hart_init() assigns mtvec.mode = 3 for CLIC vectored mode of
+     * operation. The mtvec.mode field is bit[0] for designs with CLINT, or
+     * [1:0] using CLIC.  mtvt, which is CLIC specific, holds the base address
+     * of the vector table built from CLIC_IRQ_MAP. */
+#if CLIC_NXTI_DISPATCH
+    /* non-SHV interrupts and exceptions go through the mnxti dispatcher */
+    hart.mtvec = (uintptr_t)&clic_nxti_trap;
+#else
+    hart.mtvec = (uintptr_t)&default_exception_handler;
+#endif
 
     /* Setup CLICCFG
-     * Turn off Selective vectoring (NVBITS = 0)
-     * Select a single preemption level of 255 (NLBITS = 0)
+     * Turn off Selective vectoring (NVBITS = 0), unless lines with shv = 0
+     *  in CLIC_IRQ_MAP are to be drained by the mnxti dispatcher
+     * Select levels 127 and 255 (NLBITS = CLIC_NLBITS = 1), so that the
+     *  level 0 deferred work on #12 runs at 127 below the level 255 lines
      * Machine mode interrupts only (NMBITS = 0)
      */
-    cliccfg = (CLICCFG_NVBITS(0) | CLICCFG_NLBITS(0) | CLICCFG_NMBITS(0));
-    write_byte(HART0_CLICCFG_ADDR, cliccfg);
+    hart.cliccfg = (CLICCFG_NVBITS(CLIC_NXTI_DISPATCH) | CLICCFG_NLBITS(CLIC_NLBITS) | CLICCFG_NMBITS(0));
 
     /* The core has a total of METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS bits in clicintcfg
      *  which specify how to encode a given interrupts pre-emption level and/or priority.
@@ -203,8 +241,10 @@ int main() {
      *
      * #NLBITS encoding  interrupt level = 255, belows are available priorities
      *   0     pp......           63,          127,            191,            255
+     *
+     * clic_irq_register() builds clicintcfg from the level and priority of
+     * each CLIC_IRQ_MAP line according to the NLBITS set here.
      */
-    clicintcfg = 255;
 
 #if ACTIVATE_NESTED_INTERRUPT
     /* cliccfg.NLBITS needs to be set for the nested interrupt
@@ -213,327 +253,486 @@ int main() {
      * #NLBITS encoding  interrupt levels
      *   0     ll......           63,          127,            191,            255
      */
-    cliccfg = read_byte(HART0_CLICCFG_ADDR);
-    cliccfg |= CLICCFG_NLBITS(METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS);
-    write_byte(HART0_CLICCFG_ADDR, cliccfg);
+    hart.cliccfg = (hart.cliccfg & ~CLICCFG_NLBITS(0xF)) | CLICCFG_NLBITS(METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS);
 #endif
 
-    /* software interrupt example */
-#if ACTIVATE_SOFTWARE_INTERRUPT
-    __mtvt_clic_vector_table[INT_ID_SOFTWARE] = (uintptr_t)&software_handler;
-    write_byte(HART0_CLICINTCFG_ADDR(INT_ID_SOFTWARE), clicintcfg);
-    SOFTWARE_INT_ENABLE;
+    /* you need to set the timer before enable irq: park mtimecmp, then
+     * start software timers on the wheel */
+    clic_timer_init();
+#if !CLIC_BENCHMARK
+    clic_timer_start(&demo_timer, clic_timer_now() + clic_ms_to_ticks(DEMO_TIMER_INTERVAL));
 #endif
-
-    /* clic software interrupt example */
-#if ACTIVATE_CLIC_SOFTWARE_INTERRUPT
-    __mtvt_clic_vector_table[INT_ID_CLIC_SOFTWARE] = (uintptr_t)&clic_software_handler;
-    write_byte(HART0_CLICINTCFG_ADDR(INT_ID_CLIC_SOFTWARE), clicintcfg);
-    CLIC_SOFTWARE_INT_ENABLE;
+#if CLIC_PROF
+    clic_prof_start(CLIC_PROF_HZ);
 #endif
 
-    /* timer interrupt example */
-#if ACTIVATE_TIMER_INTERRUPT
-    __mtvt_clic_vector_table[INT_ID_TIMER] = (uintptr_t)&timer_handler;
-    write_byte(HART0_CLICINTCFG_ADDR(INT_ID_TIMER), clicintcfg);
-
-    /* you need to set the timer before enable irq*/
-    SET_TIMER_INTERVAL_MS(DEMO_TIMER_INTERVAL);
-    TIMER_INT_ENABLE;
-#endif
+    /* mtvec, mtvt and cliccfg, then configure level/priority and enable
+     * every interrupt in CLIC_IRQ_MAP */
+    irq_setup_cycles = clic_hart_init(&hart);
 
-    /* external interrupt example */
-#if ACTIVATE_EXTERNAL_INTERRUPT
-    __mtvt_clic_vector_table[INT_ID_EXTERNAL] = (uintptr_t)&external_handler;
-    write_byte(HART0_CLICINTCFG_ADDR(INT_ID_EXTERNAL), clicintcfg);
-    EXTERNAL_INT_ENABLE;
-#endif
-
-#if ACTIVATE_LOCAL_EXT_INTERRUPT
-    /* how to set clic local external interrupt
-     *  1. select irq number (16 ~ (METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS-1))
-     *  2. set level(including priority) of irq on clicintcfg
-     *  3. register irq handler
-     *  4. enable irq
-     * /
-
-    /* local_ext_irq0 */
-    i = 16;
-    /* configure level/priority*/
-    write_byte(HART0_CLICINTCFG_ADDR(i), 255);
-    /* register the irq handler */
-    __mtvt_clic_vector_table[i] = (uintptr_t)&lc0_handler;
-    /* enable local_ext_irq0 */
-    write_byte(HART0_CLICINTIE_ADDR(i), ENABLE);
-
-    /* local_ext_irq1 */
-    //i = 17;
-
-    /* local_ext_irq16 */
-    //i = 32;
-
-    /* local_ext_irq31 */
-    //i = 47;
+#if CLIC_TRACE
+    /* Keep the latest interrupt activity for tools/clic_trace_decode */
+    clic_trace_start(CLIC_TRACE_FLIGHT);
 #endif
 
     /* Write mstatus.mie = 1 to enable all machine interrupts */
     interrupt_global_enable();
 
-#if ACTIVATE_SOFTWARE_INTERRUPT
-    /* Set Software Pending Bit to trigger irq*/
-    write_word(MSIP_BASE_ADDR(read_csr(mhartid)), 0x1);
+#if CLIC_BENCHMARK
+    /* Measure entry/exit latency of the software, timer and CLIC software
+     * interrupts, results are printed as CSV */
+    clic_bench_run();
 #endif
 
-#if ACTIVATE_CLIC_SOFTWARE_INTERRUPT
-    /* Set Software Pending Bit to trigger irq*/
-    CLIC_SOFTWARE_INT_SET;
+#if !CLIC_BENCHMARK
+    /* Post a message to the next hart (to this one on a single hart design),
+     * which rings its software interrupt */
+    clic_mbox_send((current_hartid() + 1) % CLIC_NUM_HARTS, demo_mbox_message, 0);
 #endif
 
     while (1) {
+        struct lc_event ev[4];
+        uint32_t i, n;
+
         // go to sleep
-        asm volatile ("wfi");
+        wait_for_interrupt();
+
+        /* Handle what the interrupt handlers queued up */
+        while ((n = lc_event_ring_pop(&lc_events, ev, 4)) != 0) {
+            for (i = 0; i < n; i++) {
+                /* Do Something with ev[i] outside of interrupt context */
+            }
+        }
     }
 
     // just for compile, but it should not return!!
     return 0;
 }
 
+/* The other harts take the interrupts in SECONDARY_IRQ_MAP, on their own
+ * CLIC and vector table; add their local external lines here to spread the
+ * interrupt load.  Software timers and deferred work stay on the boot hart. */
+#define SECONDARY_IRQ_MAP(IRQ)                                                  \
+    IRQ(INT_ID_SOFTWARE,      255, 255, 1, CLIC_TRIGGER_LEVEL, software_handler)
+
+#ifndef CLIC_BOOT_HART
+#define CLIC_BOOT_HART                          0
+#endif
+
+CLIC_DEFINE_HART_VECTOR_TABLE(secondary_mtvt, SECONDARY_IRQ_MAP);
+
+static const clic_irq_t secondary_irq_table[] = {
+    SECONDARY_IRQ_MAP(CLIC_IRQ_ENTRY)
+};
+
+static const clic_hart_t secondary_hart = {
+    .mtvec = (uintptr_t)&default_exception_handler,
+    .mtvt = secondary_mtvt,
+    .cliccfg = (CLICCFG_NVBITS(0) | CLICCFG_NLBITS(0) | CLICCFG_NMBITS(0)),
+    .irqs = secondary_irq_table,
+    .count = sizeof(secondary_irq_table) / sizeof(secondary_irq_table[0]),
+};
+
+#if CLIC_ISTACK
+/* Interrupt stack per hart, sized for the deepest nesting either map allows */
+CLIC_DEFINE_ISTACK(CLIC_MAX(CLIC_NEST_DEPTH(CLIC_IRQ_MAP), CLIC_NEST_DEPTH(SECONDARY_IRQ_MAP)));
+#endif
+
+/* Every hart enters here from crt0, the boot hart goes on to main() and
+ * the others bring up their own CLIC and sleep between interrupts */
+int secondary_main() {
+
+    if (read_csr(mhartid) == CLIC_BOOT_HART)
+        return main();
+
+    clic_ctx_init();
+    clic_hart_init(&secondary_hart);
+    interrupt_global_enable();
+
+    while (1)
+        wait_for_interrupt();
+
+    return 0;
+}
+
 /* External Interrupt ID #11 - handles all global interrupts */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) external_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) external_handler (void) {
 
     /* The external interrupt is usually used for a PLIC, which handles global
      * interrupt dispatching.  If no PLIC is connected, then custom IP can connect
      * to this interrupt line, and this is where interrupt handling
      * support would reside.  This demo does not use the PLIC.
      */
+    CLIC_STATS_ENTRY();
+
+    CLIC_STATS_EXIT();
 }
 
 /* Software Interrupt ID #3 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) software_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) software_handler (void) {
 
-    /* Clear Software Pending Bit */
-    write_word(MSIP_BASE_ADDR(read_csr(mhartid)), 0x0);
+    CLIC_BENCH_ENTRY();
+    CLIC_STATS_ENTRY();
 
-    /* Do Something after clear SW irq pending*/
+    /* Clear Software Pending Bit and run what other harts (or this one)
+     * sent with clic_mbox_send() */
+    clic_mbox_run();
+
+    CLIC_STATS_EXIT();
+    CLIC_BENCH_EXIT();
 }
 
 /* Timer Interrupt ID #7 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) timer_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) timer_handler (void) {
+
+    /* First, a preempting handler would overwrite mepc */
+    CLIC_PROF_ENTRY();
+
+    CLIC_BENCH_ENTRY();
+    CLIC_STATS_ENTRY();
 
-    /* Disable timer interrupt or Set next timer*/
-    TIMER_INT_DISABLE;
+    /* Expire every software timer that is due and set the next one,
+     * mtimecmp is parked when none is left */
+    clic_timer_run();
 
-    /* Just Do Something when the timer is expired */
+    CLIC_STATS_EXIT();
+    CLIC_BENCH_EXIT();
 }
 
 /* CLIC Software Interrupt ID #12 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) clic_software_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) clic_software_handler (void) {
+
+    CLIC_BENCH_ENTRY();
+    CLIC_STATS_ENTRY();
 
     /* Clear Software Pending Bit */
     CLIC_SOFTWARE_INT_CLEAR;
 
-    /* Do Something after clear SW irq pending*/
+    /* Run the work the other handlers deferred with clic_defer() */
+    clic_defer_run();
+
+    CLIC_STATS_EXIT();
+    CLIC_BENCH_EXIT();
+}
+
+/* Heavy part of local irq0, run at the level of interrupt #12 */
+static void lc0_work (clic_work_t *work) {
+    /* Add functionality if desired */
+
 }
 
+static clic_work_t lc0_deferred = CLIC_WORK_INIT(lc0_work);
+
 /* local irq0 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc0_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc0_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    /* Queue the event for the main loop, dropped if the ring is full */
+    struct lc_event ev = { 16, (uint32_t)read_csr(mcycle) };
+
+    lc_event_ring_push1(&lc_events, &ev);
+
+    /* Leave the rest to deferred work */
+    clic_defer(&lc0_deferred);
+
+    CLIC_STATS_EXIT();
+}
+
+/* One event of local irq1, from its handler or from a poll */
+static void lc1_event (clic_poll_t *poll) {
+    /* Add functionality if desired, acknowledging the device */
+
 }
 
+/* Polled above 64 events per ms, every 125us with up to 16 events a poll,
+ * back to interrupts at 8 events per ms or fewer */
+static clic_poll_t lc1_poll = CLIC_POLL_INIT(17, lc1_event, 16, 64, 8,
+                                             CLIC_POLL_TICKS(1000), CLIC_POLL_TICKS(8000));
+
 /* local irq1 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc1_handler (void) {
-    /* Add functionality if desired */
+void __attribute__((weak, CLIC_HANDLER)) lc1_handler (void) {
+    CLIC_STATS_ENTRY();
+
+    clic_poll_irq(&lc1_poll);
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq2 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc2_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc2_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq3 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc3_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc3_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq4 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc4_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc4_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq5 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc5_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc5_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq6 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc6_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc6_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq7 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc7_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc7_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq8 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc8_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc8_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq9 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc9_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc9_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq10 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc10_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc10_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq11 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc11_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc11_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq12 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc12_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc12_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq13 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc13_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc13_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq14 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc14_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc14_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq15 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc15_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc15_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq16 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc16_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc16_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq17 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc17_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc17_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq18 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc18_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc18_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq19 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc19_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc19_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq20 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc20_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc20_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq21 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc21_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc21_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq22 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc22_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc22_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq23 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc23_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc23_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq24 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc24_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc24_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq25 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc25_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc25_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq26 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc26_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc26_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq27 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc27_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc27_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq28 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc28_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc28_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq29 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc29_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc29_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq30 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc30_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc30_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
 /* local irq31 */
-void __attribute__((weak, interrupt("SiFive-CLIC-preemptible"))) lc31_handler (void) {
+void __attribute__((weak, CLIC_HANDLER)) lc31_handler (void) {
+    CLIC_STATS_ENTRY();
+
     /* Add functionality if desired */
 
+    CLIC_STATS_EXIT();
 }
 
-void __attribute__((weak, aligned(64))) default_exception_handler(void) {
-
-    /* Read mcause to understand the exception type */
-    uintptr_t mcause = read_csr(mcause);
-    uintptr_t mepc = read_csr(mepc);
-    uintptr_t mtval = read_csr(mtval);
-    uintptr_t code = MCAUSE_CODE(mcause);
+/* Record mcause/mepc/mtval and the faulting sp/ra in the crash log, then
+ * halt in clic_crash_halt() */
+void __attribute__((weak, CLIC_CRASH_HANDLER, aligned(64))) default_exception_handler(void) {
 
-    while (1);
+    CLIC_CRASH_ENTRY();
 }
@@ -0,0 +1,477 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host register model of the CLIC/CLINT, see clic_model.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <metal/machine.h>
+#include <metal/machine/platform.h>
+
+#include "clic_model.h"
+
+#define NUMINTS                 METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS
+#define NUMINTBITS              METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS
+
+/* Register windows, relative to METAL_SIFIVE_CLIC0_0_BASE_ADDRESS */
+#define MSIP_OFF                METAL_SIFIVE_CLIC0_MSIP_BASE
+#define MTIMECMP_OFF            METAL_SIFIVE_CLIC0_MTIMECMP_BASE
+#define MTIME_OFF               METAL_SIFIVE_CLIC0_MTIME
+#define HART_CLIC_OFF           0x00800000UL
+#define CLICINTIP_OFF           (HART_CLIC_OFF + METAL_SIFIVE_CLIC0_CLICINTIP_BASE)
+#define CLICINTIE_OFF           (HART_CLIC_OFF + METAL_SIFIVE_CLIC0_CLICINTIE_BASE)
+#define CLICINTCTL_OFF          (HART_CLIC_OFF + METAL_SIFIVE_CLIC0_CLICINTCTL_BASE)
+#define CLICCFG_OFF             (HART_CLIC_OFF + METAL_SIFIVE_CLIC0_CLICCFG)
+
+#define INT_ID_SOFTWARE         3
+#define INT_ID_TIMER            7
+
+#define MSTATUS_MIE             0x00000008UL
+#define MSTATUS_MPIE            0x00000080UL
+#define MCAUSE_INTERRUPT        0x80000000UL
+#define MCAUSE_MPIE             0x08000000UL
+#define MCAUSE_MPIL_SHIFT       16
+#define MCAUSE_MPIL_MASK        (0xFFUL << MCAUSE_MPIL_SHIFT)
+#define MINTSTATUS_MIL_SHIFT    24
+
+/* clicintctl bits below NUMINTBITS are not implemented and read as one */
+#define CLICINTCTL_IMPL_MASK    ((uint8_t)(0xFF << (8 - NUMINTBITS)))
+
+typedef void (*handler_t)(void);
+
+static struct {
+    uint8_t clicintip[NUMINTS];
+    uint8_t clicintie[NUMINTS];
+    uint8_t clicintctl[NUMINTS];
+    uint8_t shv[NUMINTS];       /* clicintctl bit 0, the SHV bit with cliccfg.nvbits */
+    uint8_t edge[NUMINTS];
+    uint8_t cliccfg;
+    uint32_t msip;
+    uint64_t mtime;
+    uint64_t mtimecmp;
+
+    uintptr_t mstatus;
+    uintptr_t mtvec;
+    uintptr_t mtvt;
+    uintptr_t mscratch;
+    uintptr_t mepc;
+    uintptr_t mcause;
+    uintptr_t mtval;
+    uint8_t mil;
+    uint8_t mintthresh;
+    uint64_t mcycle;
+    uint64_t minstret;
+
+    uint64_t taken;
+    uintptr_t site;             /* where the code that made the model arbitrate resumes */
+    int (*idle_hook)(void);
+} m;
+
+/* Interrupts are taken from inside the model's entry points, so the
+ * interrupted code resumes at the return address of the entry point */
+#define ENTER()                 (m.site = (uintptr_t)__builtin_return_address(0))
+
+uintptr_t clic_model_tp;
+
+static void fatal(const char *what, uintptr_t where)
+{
+    fprintf(stderr, "clic_model: %s 0x%lx\n", what, (unsigned long)where);
+    abort();
+}
+
+static unsigned nlbits(void)
+{
+    unsigned n = (m.cliccfg >> 1) & 0xF;
+    return n > 8 ? 8 : n;
+}
+
+static int pending(unsigned id)
+{
+    if (id == INT_ID_SOFTWARE)
+        return m.msip & 1;
+    if (id == INT_ID_TIMER)
+        return m.mtime >= m.mtimecmp;
+    return m.clicintip[id] & 1;
+}
+
+static uint8_t level_of(unsigned id)
+{
+    uint8_t lmask = (uint8_t)(0xFF00 >> nlbits());
+    return (m.clicintctl[id] & lmask) | (uint8_t)~lmask;
+}
+
+static int shv(unsigned id)
+{
+    /* With cliccfg.nvbits clear every interrupt is vectored in CLIC mode */
+    return !(m.cliccfg & 1) || m.shv[id];
+}
+
+/* Taken through the table at mtvt rather than at mtvec.base */
+static int vectored(unsigned id)
+{
+    return (m.mtvec & 3) == 3 && shv(id);
+}
+
+/* Pending, enabled and above both the current level and mintthresh */
+static int wakeable(unsigned id)
+{
+    uint8_t floor = m.mil > m.mintthresh ? m.mil : m.mintthresh;
+
+    return m.clicintie[id] && pending(id) && level_of(id) > floor;
+}
+
+/* Highest clicintctl wins (level, then priority), ties go to the highest ID */
+static int highest(uint8_t floor)
+{
+    int id, best = -1;
+
+    for (id = 0; id < NUMINTS; id++) {
+        if (!m.clicintie[id] || !pending(id) || level_of(id) <= floor)
+            continue;
+        if (best < 0 || m.clicintctl[id] >= m.clicintctl[best])
+            best = id;
+    }
+    return best;
+}
+
+static int select_irq(void)
+{
+    if (!(m.mstatus & MSTATUS_MIE))
+        return -1;
+    return highest(m.mil > m.mintthresh ? m.mil : m.mintthresh);
+}
+
+static void arbitrate(void);
+
+static void take(unsigned id)
+{
+    uintptr_t mpie = m.mstatus & MSTATUS_MIE;
+    uintptr_t mcause, mepc = m.mepc, site = m.site;
+    handler_t handler;
+
+    if (m.edge[id]) {
+        m.edge[id] = 0;
+        m.clicintip[id] = 0;
+    }
+
+    /* Trap entry */
+    mcause = MCAUSE_INTERRUPT | (mpie ? MCAUSE_MPIE : 0) |
+             ((uintptr_t)m.mil << MCAUSE_MPIL_SHIFT) | id;
+    m.mcause = mcause;
+    m.mepc = site;
+    m.mstatus = (m.mstatus & ~(MSTATUS_MIE | MSTATUS_MPIE)) | (mpie ? MSTATUS_MPIE : 0);
+    m.mil = level_of(id);
+    m.mcycle += CLIC_MODEL_TRAP_ENTRY_CYCLES;
+    m.taken++;
+
+    if (vectored(id))
+        handler = (handler_t)((uintptr_t *)m.mtvt)[id];
+    else
+        handler = (handler_t)(m.mtvec & ~(uintptr_t)0x3F);
+    if (!handler)
+        fatal("no handler for interrupt", id);
+
+    /* "SiFive-CLIC-preemptible" prologue re-enables interrupts, anything
+     * taken there preempts the handler's first instruction */
+    m.mstatus |= MSTATUS_MIE;
+    m.site = (uintptr_t)handler;
+    arbitrate();
+
+    handler();
+
+    /* Epilogue restores mcause and mepc, then mret */
+    m.mcause = mcause;
+    m.mepc = mepc;
+    m.site = site;
+    m.mil = (mcause & MCAUSE_MPIL_MASK) >> MCAUSE_MPIL_SHIFT;
+    m.mstatus = (m.mstatus & ~MSTATUS_MIE) | ((mcause & MCAUSE_MPIE) ? MSTATUS_MIE : 0) | MSTATUS_MPIE;
+    m.mcycle += CLIC_MODEL_TRAP_EXIT_CYCLES;
+}
+
+static void arbitrate(void)
+{
+    int id;
+
+    while ((id = select_irq()) >= 0)
+        take(id);
+}
+
+static uint8_t mmio_read8(uintptr_t off)
+{
+    if (off - MSIP_OFF < 4)
+        return (uint8_t)(m.msip >> (8 * (off - MSIP_OFF)));
+    if (off >= MTIMECMP_OFF && off < MTIMECMP_OFF + 8)
+        return (uint8_t)(m.mtimecmp >> (8 * (off - MTIMECMP_OFF)));
+    if (off >= MTIME_OFF && off < MTIME_OFF + 8)
+        return (uint8_t)(m.mtime >> (8 * (off - MTIME_OFF)));
+    if (off >= CLICINTIP_OFF && off < CLICINTIP_OFF + NUMINTS)
+        return (uint8_t)pending(off - CLICINTIP_OFF);
+    if (off >= CLICINTIE_OFF && off < CLICINTIE_OFF + NUMINTS)
+        return m.clicintie[off - CLICINTIE_OFF];
+    if (off >= CLICINTCTL_OFF && off < CLICINTCTL_OFF + NUMINTS)
+        return (m.cliccfg & 1) ? (m.clicintctl[off - CLICINTCTL_OFF] & 0xFE) | m.shv[off - CLICINTCTL_OFF]
+                               : m.clicintctl[off - CLICINTCTL_OFF];
+    if (off == CLICCFG_OFF)
+        return m.cliccfg;
+    fatal("read from unmapped offset", off);
+    return 0;
+}
+
+static uint64_t set_byte(uint64_t reg, unsigned lane, uint8_t v)
+{
+    return (reg & ~(0xFFULL << (8 * lane))) | ((uint64_t)v << (8 * lane));
+}
+
+static void mmio_write8(uintptr_t off, uint8_t v)
+{
+    unsigned id;
+
+    if (off - MSIP_OFF < 4) {
+        /* only msip bit 0 is implemented */
+        if (off == MSIP_OFF)
+            m.msip = v & 1;
+    } else if (off >= MTIMECMP_OFF && off < MTIMECMP_OFF + 8) {
+        m.mtimecmp = set_byte(m.mtimecmp, off - MTIMECMP_OFF, v);
+    } else if (off >= MTIME_OFF && off < MTIME_OFF + 8) {
+        m.mtime = set_byte(m.mtime, off - MTIME_OFF, v);
+    } else if (off >= CLICINTIP_OFF && off < CLICINTIP_OFF + NUMINTS) {
+        /* msip and the timer comparator drive IDs 3 and 7 */
+        id = off - CLICINTIP_OFF;
+        if (id != INT_ID_SOFTWARE && id != INT_ID_TIMER) {
+            m.clicintip[id] = v & 1;
+            m.edge[id] = 0;
+        }
+    } else if (off >= CLICINTIE_OFF && off < CLICINTIE_OFF + NUMINTS) {
+        m.clicintie[off - CLICINTIE_OFF] = v & 1;
+    } else if (off >= CLICINTCTL_OFF && off < CLICINTCTL_OFF + NUMINTS) {
+        m.clicintctl[off - CLICINTCTL_OFF] = (v & CLICINTCTL_IMPL_MASK) | (uint8_t)~CLICINTCTL_IMPL_MASK;
+        m.shv[off - CLICINTCTL_OFF] = v & 1;
+    } else if (off == CLICCFG_OFF) {
+        m.cliccfg = v & 0x7F;
+    } else {
+        fatal("write to unmapped offset", off);
+    }
+}
+
+uint64_t clic_model_mmio_read(uintptr_t addr, unsigned size)
+{
+    uintptr_t off = addr - METAL_SIFIVE_CLIC0_0_BASE_ADDRESS;
+    uint64_t data = 0;
+    unsigned i;
+
+    if (addr < METAL_SIFIVE_CLIC0_0_BASE_ADDRESS || (addr & (size - 1)))
+        fatal("bad read address", addr);
+    for (i = 0; i < size; i++)
+        data |= (uint64_t)mmio_read8(off + i) << (8 * i);
+    m.mcycle += CLIC_MODEL_ACCESS_CYCLES;
+    return data;
+}
+
+void clic_model_mmio_write(uintptr_t addr, uint64_t data, unsigned size)
+{
+    uintptr_t off = addr - METAL_SIFIVE_CLIC0_0_BASE_ADDRESS;
+    unsigned i;
+
+    ENTER();
+    if (addr < METAL_SIFIVE_CLIC0_0_BASE_ADDRESS || (addr & (size - 1)))
+        fatal("bad write address", addr);
+    for (i = 0; i < size; i++)
+        mmio_write8(off + i, (uint8_t)(data >> (8 * i)));
+    m.mcycle += CLIC_MODEL_ACCESS_CYCLES;
+    arbitrate();
+}
+
+/* mnxti: claim the highest pending non-SHV interrupt above mcause.mpil and
+ * mintthresh, then apply the write to mstatus.  Returns the address of its
+ * mtvt entry, or 0 when there is none (or the highest one is SHV). */
+static uintptr_t nxti(uintptr_t set, uintptr_t clear)
+{
+    uint8_t mpil = (uint8_t)((m.mcause & MCAUSE_MPIL_MASK) >> MCAUSE_MPIL_SHIFT);
+    uintptr_t entry = 0;
+    int id;
+
+    id = highest(mpil > m.mintthresh ? mpil : m.mintthresh);
+    if (id >= 0 && !vectored(id)) {
+        if (m.edge[id]) {
+            m.edge[id] = 0;
+            m.clicintip[id] = 0;
+        }
+        m.mil = level_of(id);
+        m.mcause = (m.mcause & ~(uintptr_t)0x3FF) | id;
+        entry = m.mtvt + id * sizeof(uintptr_t);
+    }
+    m.mstatus = (m.mstatus | (set & MSTATUS_MIE)) & ~(clear & MSTATUS_MIE);
+    m.mcycle += CLIC_MODEL_ACCESS_CYCLES;
+    arbitrate();
+    return entry;
+}
+
+static uintptr_t csr_read(unsigned csr)
+{
+    uintptr_t val;
+
+    switch (csr) {
+    case CLIC_CSR_mstatus:      val = m.mstatus; break;
+    case CLIC_CSR_mtvec:        val = m.mtvec; break;
+    case CLIC_CSR_mtvt:         val = m.mtvt; break;
+    case CLIC_CSR_mscratch:     val = m.mscratch; break;
+    case CLIC_CSR_mepc:         val = m.mepc; break;
+    case CLIC_CSR_mcause:       val = m.mcause; break;
+    case CLIC_CSR_mtval:        val = m.mtval; break;
+    case CLIC_CSR_mnxti:        return nxti(0, 0);
+    case CLIC_CSR_mintstatus:   val = (uintptr_t)m.mil << MINTSTATUS_MIL_SHIFT; break;
+    case CLIC_CSR_mintthresh:   val = m.mintthresh; break;
+    case CLIC_CSR_mcycle:       val = (uintptr_t)m.mcycle; break;
+    case CLIC_CSR_mcycleh:      val = (uintptr_t)(m.mcycle >> 32); break;
+    case CLIC_CSR_minstret:     val = (uintptr_t)m.minstret; break;
+    case CLIC_CSR_minstreth:    val = (uintptr_t)(m.minstret >> 32); break;
+    case CLIC_CSR_mhartid:      val = 0; break;
+    default:
+        fatal("read of unmodelled csr", csr);
+        return 0;
+    }
+    m.mcycle += CLIC_MODEL_ACCESS_CYCLES;
+    return val;
+}
+
+static void csr_write(unsigned csr, uintptr_t val)
+{
+    switch (csr) {
+    case CLIC_CSR_mstatus:      m.mstatus = val; break;
+    case CLIC_CSR_mtvec:        m.mtvec = val; break;
+    case CLIC_CSR_mtvt:         m.mtvt = val & ~(uintptr_t)0x3F; break;
+    case CLIC_CSR_mscratch:     m.mscratch = val; break;
+    case CLIC_CSR_mepc:         m.mepc = val; break;
+    case CLIC_CSR_mcause:       m.mcause = val; break;
+    case CLIC_CSR_mtval:        m.mtval = val; break;
+    case CLIC_CSR_mintthresh:   m.mintthresh = (uint8_t)val; break;
+    case CLIC_CSR_mcycle:       m.mcycle = val; return;
+    case CLIC_CSR_minstret:     m.minstret = val; break;
+    default:
+        fatal("write of unmodelled csr", csr);
+    }
+    m.mcycle += CLIC_MODEL_ACCESS_CYCLES;
+    arbitrate();
+}
+
+uintptr_t clic_model_csr_read(unsigned csr)
+{
+    ENTER();
+    return csr_read(csr);
+}
+
+void clic_model_csr_write(unsigned csr, uintptr_t val)
+{
+    ENTER();
+    csr_write(csr, val);
+}
+
+uintptr_t clic_model_csr_set(unsigned csr, uintptr_t bits)
+{
+    uintptr_t old;
+
+    ENTER();
+    if (csr == CLIC_CSR_mnxti)
+        return nxti(bits, 0);
+    old = csr_read(csr);
+
+    csr_write(csr, old | bits);
+    return old;
+}
+
+uintptr_t clic_model_csr_clear(unsigned csr, uintptr_t bits)
+{
+    uintptr_t old;
+
+    ENTER();
+    if (csr == CLIC_CSR_mnxti)
+        return nxti(0, bits);
+    old = csr_read(csr);
+
+    csr_write(csr, old & ~bits);
+    return old;
+}
+
+static int any_wakeable(void)
+{
+    int id;
+
+    for (id = 0; id < NUMINTS; id++)
+        if (wakeable(id))
+            return 1;
+    return 0;
+}
+
+void clic_model_wfi(void)
+{
+    ENTER();
+    m.mcycle += CLIC_MODEL_ACCESS_CYCLES;
+    while (!any_wakeable()) {
+        /* Sleep until the armed comparator fires */
+        if (m.clicintie[INT_ID_TIMER] && m.mtimecmp != UINT64_MAX &&
+            m.mtimecmp > m.mtime) {
+            m.mtime = m.mtimecmp;
+            continue;
+        }
+        if (m.idle_hook && m.idle_hook())
+            continue;
+        exit(EXIT_SUCCESS);
+    }
+    arbitrate();
+}
+
+void clic_model_reset(void)
+{
+    int (*hook)(void) = m.idle_hook;
+
+    memset(&m, 0, sizeof(m));
+    memset(m.clicintctl, (uint8_t)~CLICINTCTL_IMPL_MASK, sizeof(m.clicintctl));
+    m.mtimecmp = UINT64_MAX;
+    m.idle_hook = hook;
+}
+
+__attribute__((constructor)) static void clic_model_init(void)
+{
+    clic_model_reset();
+}
+
+void clic_model_raise(unsigned int_id)
+{
+    ENTER();
+    if (int_id >= NUMINTS || int_id == INT_ID_SOFTWARE || int_id == INT_ID_TIMER)
+        fatal("cannot raise interrupt", int_id);
+    m.clicintip[int_id] = 1;
+    m.edge[int_id] = 1;
+    arbitrate();
+}
+
+void clic_model_set_line(unsigned int_id, int level)
+{
+    ENTER();
+    if (int_id >= NUMINTS || int_id == INT_ID_SOFTWARE || int_id == INT_ID_TIMER)
+        fatal("cannot drive interrupt", int_id);
+    m.clicintip[int_id] = level ? 1 : 0;
+    m.edge[int_id] = 0;
+    arbitrate();
+}
+
+void clic_model_advance_mtime(uint64_t ticks)
+{
+    ENTER();
+    m.mtime += ticks;
+    arbitrate();
+}
+
+void clic_model_set_idle_hook(int (*hook)(void))
+{
+    m.idle_hook = hook;
+}
+
+uint64_t clic_model_taken(void)
+{
+    return m.taken;
+}
@@ -0,0 +1,103 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host register model of the SiFive CLIC (clicintip/clicintie/clicintctl/
+ * cliccfg), the CLINT compatible MSIP/mtime/mtimecmp block and the machine
+ * mode CSRs the example touches.  clic_hal.h routes every access here when
+ * the sources are built with CLIC_HOST_MODEL=1.
+ *
+ * Interrupts are taken synchronously: after every register write that can
+ * change the arbitration result (and in wfi) the model picks the highest
+ * pending-and-enabled interrupt, performs the CLIC trap entry (mcause.mpil,
+ * mpie, mintstatus.mil), calls the handler found in the table at mtvt (or
+ * at mtvec.base for non-vectored interrupts) and performs mret afterwards.
+ * Handlers are treated like "SiFive-CLIC-preemptible" ones, so higher
+ * levels nest into them.  mepc is the address the interrupted code resumes
+ * at, i.e. the return address of the model call that took the interrupt,
+ * and is restored when the handler returns.
+ * Reading mnxti (csrrsi/csrrci on 0x345) claims the highest pending non-SHV
+ * interrupt above mcause.mpil like the hardware does, for dispatchers that
+ * drain interrupts in a loop.
+ *
+ * mcycle is a virtual, deterministic counter: it advances by a fixed cost
+ * per modelled MMIO/CSR access and per trap entry/exit, not by host time.
+ * mtime only moves in wfi (to the armed mtimecmp) or through
+ * clic_model_advance_mtime().
+ */
+
+#ifndef CLIC_MODEL_H
+#define CLIC_MODEL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Nominal cost, in mcycle ticks, of the modelled operations */
+#ifndef CLIC_MODEL_ACCESS_CYCLES
+#define CLIC_MODEL_ACCESS_CYCLES                1
+#endif
+#ifndef CLIC_MODEL_TRAP_ENTRY_CYCLES
+#define CLIC_MODEL_TRAP_ENTRY_CYCLES            6
+#endif
+#ifndef CLIC_MODEL_TRAP_EXIT_CYCLES
+#define CLIC_MODEL_TRAP_EXIT_CYCLES             4
+#endif
+
+/* CSR numbers, by name and by the raw numbers the sources use for the
+ * CLIC CSRs older assemblers do not know about */
+enum {
+    CLIC_CSR_mstatus        = 0x300,
+    CLIC_CSR_mtvec          = 0x305,
+    CLIC_CSR_mtvt           = 0x307,
+    CLIC_CSR_0x307          = 0x307,
+    CLIC_CSR_mscratch       = 0x340,
+    CLIC_CSR_mepc           = 0x341,
+    CLIC_CSR_mcause         = 0x342,
+    CLIC_CSR_mtval          = 0x343,
+    CLIC_CSR_mnxti          = 0x345,
+    CLIC_CSR_0x345          = 0x345,
+    CLIC_CSR_mintstatus     = 0x346,
+    CLIC_CSR_0x346          = 0x346,
+    CLIC_CSR_mintthresh     = 0x347,
+    CLIC_CSR_0x347          = 0x347,
+    CLIC_CSR_mcycle         = 0xB00,
+    CLIC_CSR_minstret       = 0xB02,
+    CLIC_CSR_mcycleh        = 0xB80,
+    CLIC_CSR_minstreth      = 0xB82,
+    CLIC_CSR_mhartid        = 0xF14,
+};
+
+/* Register access backend used by clic_hal.h */
+uint64_t clic_model_mmio_read(uintptr_t addr, unsigned size);
+void clic_model_mmio_write(uintptr_t addr, uint64_t data, unsigned size);
+uintptr_t clic_model_csr_read(unsigned csr);
+void clic_model_csr_write(unsigned csr, uintptr_t val);
+uintptr_t clic_model_csr_set(unsigned csr, uintptr_t bits);
+uintptr_t clic_model_csr_clear(unsigned csr, uintptr_t bits);
+void clic_model_wfi(void);
+
+/* The tp (thread pointer) register, a plain variable on the host */
+extern uintptr_t clic_model_tp;
+
+/* Stimulus for harnesses and benchmarks */
+void clic_model_reset(void);
+void clic_model_raise(unsigned int_id);     /* edge: pending until vectored */
+void clic_model_set_line(unsigned int_id, int level);   /* level sensitive */
+void clic_model_advance_mtime(uint64_t ticks);
+
+/* Called from wfi when nothing can ever wake the hart.  Return non-zero
+ * after injecting new stimulus; with no hook (or a zero return) the
+ * process exits, which is how main()'s endless wfi loop terminates. */
+void clic_model_set_idle_hook(int (*hook)(void));
+
+/* Number of interrupts taken since reset, for throughput measurements */
+uint64_t clic_model_taken(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLIC_MODEL_H */
@@ -0,0 +1,23 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Stand-in for the BSP generated metal/machine.h, used only by the host
+ * build (CLIC_HOST_MODEL).  Values follow a single hart E2-series design
+ * with a CLIC and 48 interrupt IDs (local external lines 16-47).
+ */
+
+#ifndef HOST_METAL__MACHINE_H
+#define HOST_METAL__MACHINE_H
+
+#include <metal/machine/platform.h>
+
+#define __METAL_DT_MAX_HARTS                    1
+
+#define METAL_MAX_CLINT_INTERRUPTS              0
+#define METAL_MAX_CLIC_INTERRUPTS               METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS
+#define METAL_MAX_PLIC_INTERRUPTS               0
+
+#define METAL_MIE_INTERRUPT                     0x00000008UL
+
+#endif /* HOST_METAL__MACHINE_H */
@@ -0,0 +1,9 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/* Stand-in for the BSP generated metal/machine/inline.h (host build only) */
+
+#ifndef HOST_METAL__MACHINE__INLINE_H
+#define HOST_METAL__MACHINE__INLINE_H
+
+#endif /* HOST_METAL__MACHINE__INLINE_H */
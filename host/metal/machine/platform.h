@@ -0,0 +1,28 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Stand-in for the BSP generated metal/machine/platform.h, used only by
+ * the host build (CLIC_HOST_MODEL).  host/clic_model.c decodes exactly
+ * this address map.
+ */
+
+#ifndef HOST_METAL__MACHINE__PLATFORM_H
+#define HOST_METAL__MACHINE__PLATFORM_H
+
+#define METAL_SIFIVE_CLIC0_0_BASE_ADDRESS       0x2000000UL
+#define METAL_SIFIVE_CLIC0_0_SIZE               0x1000000UL
+#define METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS     48
+#define METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTBITS  4
+#define METAL_SIFIVE_CLIC0_0_SIFIVE_NUMLEVELS   16
+#define METAL_SIFIVE_CLIC0_2000000_SIFIVE_NUMINTS  METAL_SIFIVE_CLIC0_0_SIFIVE_NUMINTS
+
+#define METAL_SIFIVE_CLIC0_MSIP_BASE            0x0UL
+#define METAL_SIFIVE_CLIC0_MTIMECMP_BASE        0x4000UL
+#define METAL_SIFIVE_CLIC0_MTIME                0xBFF8UL
+#define METAL_SIFIVE_CLIC0_CLICINTIP_BASE       0x000UL
+#define METAL_SIFIVE_CLIC0_CLICINTIE_BASE       0x400UL
+#define METAL_SIFIVE_CLIC0_CLICINTCTL_BASE      0x800UL
+#define METAL_SIFIVE_CLIC0_CLICCFG              0xC00UL
+
+#endif /* HOST_METAL__MACHINE__PLATFORM_H */
@@ -0,0 +1,118 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check of the mintthresh critical sections: lines at or below the
+ * ceiling wait for clic_crit_exit(), lines above it are taken inside the
+ * section, an inner section never lowers an outer ceiling and
+ * CLIC_CRIT_ALL masks every line.  Built with CLIC_CRIT_STATS=1, the
+ * longest window per ceiling is checked too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_irq.h"
+#include "clic_ctx.h"
+#include "clic_crit.h"
+
+/* NLBITS = 2: levels 63, 127, 191 and 255 */
+#define LOW                     16
+#define HIGH                    17
+#define LOW_LEVEL               63
+#define HIGH_LEVEL              191
+/* mcycle a section is made to take for the window check */
+#define WINDOW                  100000
+
+static void low_handler(void);
+static void high_handler(void);
+
+#define TEST_IRQ_MAP(IRQ)                                                       \
+    IRQ(LOW,  LOW_LEVEL,  0, 1, CLIC_TRIGGER_LEVEL, low_handler)                \
+    IRQ(HIGH, HIGH_LEVEL, 0, 1, CLIC_TRIGGER_LEVEL, high_handler)
+
+#define TEST_NAME               "test_crit"
+#include "test_hart.h"
+
+static volatile unsigned low_ran, high_ran;
+static unsigned failures;
+
+static void low_handler(void) {
+
+    write_byte(CLICINTIP_ADDR(LOW), DISABLE);
+    low_ran++;
+}
+
+static void high_handler(void) {
+
+    write_byte(CLICINTIP_ADDR(HIGH), DISABLE);
+    high_ran++;
+}
+
+static void check(const char *what, unsigned got, unsigned want) {
+
+    if (got != want) {
+        printf("FAIL %s: %u, want %u\n", what, got, want);
+        failures++;
+    }
+}
+
+int main(void) {
+
+    clic_crit_t outer, inner;
+
+    clic_ctx_init();
+    test_hart_init(2);
+    interrupt_global_enable();
+
+    /* Ceiling between the two lines */
+    outer = clic_crit_enter(127);
+    check("threshold raised", (unsigned)read_csr(0x347), 127);
+    write_byte(CLICINTIP_ADDR(LOW), ENABLE);
+    write_byte(CLICINTIP_ADDR(HIGH), ENABLE);
+    check("low inside", low_ran, 0);
+    check("high inside", high_ran, 1);
+    clic_crit_exit(outer);
+    check("low at exit", low_ran, 1);
+    check("threshold restored", (unsigned)read_csr(0x347), 0);
+
+    /* A lower inner ceiling keeps the outer one */
+    outer = clic_crit_enter(HIGH_LEVEL);
+    inner = clic_crit_enter(127);
+    check("inner threshold", (unsigned)read_csr(0x347), HIGH_LEVEL);
+    write_byte(CLICINTIP_ADDR(HIGH), ENABLE);
+    clic_crit_exit(inner);
+    check("high after inner exit", high_ran, 1);
+    check("outer threshold", (unsigned)read_csr(0x347), HIGH_LEVEL);
+    clic_crit_exit(outer);
+    check("high after outer exit", high_ran, 2);
+
+    /* A higher inner ceiling is undone by its own exit */
+    outer = clic_crit_enter(127);
+    inner = clic_crit_enter(CLIC_CRIT_ALL);
+    write_byte(CLICINTIP_ADDR(HIGH), ENABLE);
+    check("high in CLIC_CRIT_ALL", high_ran, 2);
+#if CLIC_CRIT_STATS
+    write_csr(mcycle, read_csr(mcycle) + WINDOW);
+#endif
+    clic_crit_exit(inner);
+    check("high after CLIC_CRIT_ALL", high_ran, 3);
+    check("back to outer", (unsigned)read_csr(0x347), 127);
+    clic_crit_exit(outer);
+
+#if CLIC_CRIT_STATS
+    if (clic_crit_max_window(CLIC_CRIT_ALL) < WINDOW || clic_crit_max_window(CLIC_CRIT_ALL) > WINDOW + 4096) {
+        printf("FAIL CLIC_CRIT_ALL window: %u, want %u..%u\n",
+               (unsigned)clic_crit_max_window(CLIC_CRIT_ALL), WINDOW, WINDOW + 4096);
+        failures++;
+    }
+    check("outer window holds the inner one", clic_crit_max_window(127) >= WINDOW, 1);
+    check("window at 191", clic_crit_max_window(HIGH_LEVEL) < WINDOW, 1);
+    clic_crit_reset();
+    check("window after reset", clic_crit_max_window(CLIC_CRIT_ALL), 0);
+#endif
+
+    printf(TEST_NAME ": %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
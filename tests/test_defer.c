@@ -0,0 +1,82 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check that a level 255 line preempts deferred work running on #12
+ * at level 0, with the cliccfg.NLBITS main() uses (CLIC_NLBITS), and that
+ * with NLBITS = 0 it waits for the work to finish.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_irq.h"
+#include "clic_ctx.h"
+#include "clic_defer.h"
+
+#define LINE                    16
+
+static void defer_handler(void);
+static void line_handler(void);
+
+#define TEST_IRQ_MAP(IRQ)                                                       \
+    IRQ(INT_ID_CLIC_SOFTWARE, 0,   0,   1, CLIC_TRIGGER_LEVEL, defer_handler)   \
+    IRQ(LINE,                 255, 255, 1, CLIC_TRIGGER_LEVEL, line_handler)
+
+#define TEST_NAME               "test_defer"
+#include "test_hart.h"
+
+static volatile int in_work, line_ran, line_ran_in_work, work_saw_line;
+static unsigned failures;
+
+static void defer_handler(void) {
+
+    CLIC_SOFTWARE_INT_CLEAR;
+    clic_defer_run();
+}
+
+static void line_handler(void) {
+
+    write_byte(CLICINTIP_ADDR(LINE), DISABLE);
+    line_ran = 1;
+    line_ran_in_work = in_work;
+}
+
+/* Long running work: raise the line half way and see whether it ran */
+static void work_fn(clic_work_t *work) {
+
+    in_work = 1;
+    write_byte(CLICINTIP_ADDR(LINE), ENABLE);
+    work_saw_line = line_ran;
+    in_work = 0;
+}
+
+static clic_work_t work = CLIC_WORK_INIT(work_fn);
+
+static void run(unsigned nlbits, int expect_preempted) {
+
+    interrupt_global_disable();
+    test_hart_init(nlbits);
+    line_ran = line_ran_in_work = work_saw_line = 0;
+    interrupt_global_enable();
+
+    clic_defer(&work);
+
+    if (!line_ran || work_saw_line != expect_preempted || line_ran_in_work != expect_preempted) {
+        printf("FAIL NLBITS = %u: line ran %d, during the work %d, expected %d\n",
+               nlbits, line_ran, line_ran_in_work, expect_preempted);
+        failures++;
+    }
+}
+
+int main(void) {
+
+    clic_ctx_init();
+
+    run(CLIC_NLBITS, 1);
+    run(0, 0);
+
+    printf(TEST_NAME ": %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Hart fixture of the register model tests.  A test declares its handlers,
+ * defines TEST_NAME and TEST_IRQ_MAP and includes this once:
+ *
+ *   #define TEST_NAME               "test_foo"
+ *   #define TEST_IRQ_MAP(IRQ) \
+ *       IRQ(16, 255, 255, 1, CLIC_TRIGGER_LEVEL, foo_handler)
+ *   #include "test_hart.h"
+ *
+ * which gives it the vector table, an exception handler that fails the
+ * test and test_hart_init() to bring the hart up with that map.
+ */
+
+#ifndef TEST_HART_H
+#define TEST_HART_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_irq.h"
+
+#if !defined(TEST_NAME) || !defined(TEST_IRQ_MAP)
+#error "define TEST_NAME and TEST_IRQ_MAP before including test_hart.h"
+#endif
+
+void default_exception_handler(void);
+
+CLIC_DEFINE_HART_VECTOR_TABLE(test_mtvt, TEST_IRQ_MAP);
+
+static const clic_irq_t test_irqs[] = { TEST_IRQ_MAP(CLIC_IRQ_ENTRY) };
+
+void default_exception_handler(void) {
+
+    fprintf(stderr, TEST_NAME ": unexpected trap, mcause 0x%lx\n", (unsigned long)read_csr(mcause));
+    exit(EXIT_FAILURE);
+}
+
+/* clic_hart_init() with TEST_IRQ_MAP and the given cliccfg.NLBITS,
+ * returns with mstatus.MIE off */
+static inline uint32_t test_hart_init(unsigned nlbits) {
+
+    const clic_hart_t hart = {
+        (uintptr_t)&default_exception_handler, test_mtvt,
+        CLICCFG_NLBITS(nlbits), test_irqs, sizeof(test_irqs) / sizeof(test_irqs[0])
+    };
+
+    return clic_hart_init(&hart);
+}
+
+#endif /* TEST_HART_H */
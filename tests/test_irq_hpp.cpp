@@ -0,0 +1,82 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check that clic_irq.hpp builds and writes what the C side writes:
+ * clic::Irq<>::configure() against clic_irq_register() for the same level
+ * and priority, the level 0 the IRQ maps use included, then the
+ * enable/pend/clear accessors and the clic::Irqs<> ranges.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C" {
+#include "clic_hal.h"
+#include "clic_irq.h"
+}
+#include "clic_irq.hpp"
+
+#define C_LINE                  16
+
+/* Level 0 as written in the maps is the lowest level, not an error */
+static_assert(clic::level_ok(0, 1) && clic::level_ok(127, 1) && !clic::level_ok(100, 1), "level 0 at NLBITS = 1");
+static_assert(clic::encode(0, 255, 1) == clic::encode(127, 255, 1), "0 and 127 are one level at NLBITS = 1");
+static_assert(clic::level_ok(0, 0) && clic::level_ok(255, 0), "level 0 at NLBITS = 0");
+
+static unsigned failures;
+
+static void check(const char *what, unsigned got, unsigned want) {
+
+    if (got != want) {
+        printf("FAIL %s: 0x%x, want 0x%x\n", what, got, want);
+        failures++;
+    }
+}
+
+static void __attribute__((used)) unused_handler(void) {
+}
+
+/* clicintctl of ID 17 through clic::Irq against ID 16 through the C table */
+template <unsigned Level, unsigned Priority, unsigned NLBits>
+static void same(const char *what) {
+
+    const clic_irq_t irq = { C_LINE, Level, Priority, 1, CLIC_TRIGGER_LEVEL, unused_handler };
+
+    write_byte(HART0_CLICCFG_ADDR, (clic::cliccfg<0, NLBits>()));
+    clic_irq_register(&irq, 1);
+    clic::Irq<C_LINE + 1>::configure<Level, Priority, NLBits>();
+    check(what, read_byte(clic::Irq<C_LINE + 1>::ctl_addr), read_byte(HART0_CLICINTCFG_ADDR(C_LINE)));
+}
+
+int main(void) {
+
+    same<0, 0, 1>("level 0 at NLBITS = 1");
+    same<127, 255, 1>("level 127 at NLBITS = 1");
+    same<128, 64, 1>("level 128 at NLBITS = 1");
+    same<255, 255, 1>("level 255 at NLBITS = 1");
+    same<63, 255, 2>("level 63 at NLBITS = 2");
+    same<192, 0, 2>("level 192 at NLBITS = 2");
+    same<0, 255, 0>("level 0 at NLBITS = 0");
+    same<255, 128, 0>("level 255 at NLBITS = 0");
+
+    clic::Irq<20>::enable();
+    check("enabled", clic::Irq<20>::enabled(), 1);
+    clic::Irq<20>::pend();
+    check("pending", clic::Irq<20>::pending(), 1);
+    clic::Irq<20>::clear();
+    check("cleared", clic::Irq<20>::pending(), 0);
+    clic::Irq<20>::disable();
+    check("disabled", clic::Irq<20>::enabled(), 0);
+
+    write_byte(HART0_CLICCFG_ADDR, (clic::cliccfg<0, clic::nlbits>()));
+    clic::Irqs<24, 27>::configure<255, 255>();
+    clic::Irqs<24, 27>::enable();
+    check("range enabled", read_word(HART0_CLICINTIE_ADDR(24)), 0x01010101);
+    check("range level", clic::level_of(read_byte(HART0_CLICINTCFG_ADDR(27)), clic::nlbits), 255);
+    clic::Irqs<24, 27>::disable();
+    check("range disabled", read_word(HART0_CLICINTIE_ADDR(24)), 0);
+
+    printf("test_irq_hpp: %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check of the periodic timer's missed-deadline accounting: a run
+ * exactly one period late skips nothing and the next deadline runs right
+ * away, a run more than a period late skips the deadlines already in the
+ * past and stays on the original grid.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_ctx.h"
+#include "clic_timer.h"
+#include "clic_model.h"
+
+#define PERIOD                  100
+
+static uint64_t base;
+static uint32_t runs;
+static unsigned failures;
+
+static void tick(clic_periodic_t *periodic) {
+
+    runs++;
+}
+
+static clic_periodic_t periodic = CLIC_PERIODIC_INIT(tick);
+
+/* Move mtime to base + at, expire what is due, compare the counters */
+static void step(uint64_t at, uint32_t want_runs, uint32_t want_missed, uint64_t want_next) {
+
+    clic_model_advance_mtime(base + at - clic_timer_now());
+    clic_timer_process(clic_timer_now());
+    if (runs != want_runs || periodic.missed != want_missed || periodic.timer.expires != base + want_next) {
+        printf("FAIL at %llu: runs %lu missed %lu next %llu, want %lu %lu %llu\n",
+               (unsigned long long)at, (unsigned long)runs, (unsigned long)periodic.missed,
+               (unsigned long long)(periodic.timer.expires - base),
+               (unsigned long)want_runs, (unsigned long)want_missed, (unsigned long long)want_next);
+        failures++;
+    }
+}
+
+int main(void) {
+
+    clic_ctx_init();
+    clic_timer_init();
+    base = clic_timer_now();
+    clic_periodic_start(&periodic, base + PERIOD, PERIOD);
+
+    step(PERIOD, 1, 0, 2 * PERIOD);                     /* on time */
+    step(3 * PERIOD, 3, 0, 4 * PERIOD);                 /* one period late: 2 and 3 both run */
+    step(5 * PERIOD + 50, 4, 1, 6 * PERIOD);            /* 4 runs late, 5 is skipped */
+    step(6 * PERIOD, 5, 1, 7 * PERIOD);
+    step(9 * PERIOD, 7, 2, 10 * PERIOD);                /* 7 runs, 8 skipped, 9 due now */
+    step(13 * PERIOD - 1, 8, 4, 13 * PERIOD);           /* 10 runs, 11 and 12 skipped */
+
+    printf("test_periodic: %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check of the CLIC_RING_DEFINE() ring against a plain counter model:
+ * single and batched push/pop, reserve/commit and peek/release, in random
+ * sizes across the slot array wrap and the wrap of the 32-bit head and
+ * tail counters.  Every call must move min(asked, possible) elements, in
+ * FIFO order, and the in-place calls must stop at the end of the array.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_ring.h"
+
+#define CAPACITY                8
+#define ROUNDS                  100000
+
+CLIC_RING_DEFINE(test_ring, uint32_t, CAPACITY);
+
+static test_ring_t ring;
+static uint32_t pushed, popped;         /* next value to push / to pop */
+static unsigned failures;
+
+static void check(const char *what, uint32_t got, uint32_t want) {
+
+    if (got != want && failures++ < 10)
+        printf("FAIL %s: %lu, want %lu (head %lu)\n", what,
+               (unsigned long)got, (unsigned long)want, (unsigned long)ring.head);
+}
+
+static uint32_t min(uint32_t a, uint32_t b) {
+
+    return a < b ? a : b;
+}
+
+static void push(uint32_t n, unsigned how) {
+
+    uint32_t buf[2 * CAPACITY], *slot, got, i, room = CAPACITY - (pushed - popped);
+
+    switch (how) {
+    case 0:
+        for (i = 0; i < n; i++)
+            buf[i] = pushed + i;
+        got = test_ring_push(&ring, buf, n);
+        check("push", got, min(n, room));
+        break;
+    case 1:
+        got = 0;
+        for (i = 0; i < n; i++) {
+            buf[0] = pushed + i;
+            got += test_ring_push1(&ring, &buf[0]);
+        }
+        check("push1", got, min(n, room));
+        break;
+    default:
+        got = n;
+        slot = test_ring_reserve(&ring, &got);
+        check("reserve", got, min(n, min(room, CAPACITY - (ring.head & (CAPACITY - 1)))));
+        for (i = 0; i < got; i++)
+            slot[i] = pushed + i;
+        test_ring_commit(&ring, got);
+        break;
+    }
+    pushed += got;
+}
+
+static void pop(uint32_t n, unsigned how) {
+
+    uint32_t buf[2 * CAPACITY], *slot, got, i, filled = pushed - popped;
+
+    switch (how) {
+    case 0:
+        got = test_ring_pop(&ring, buf, n);
+        check("pop", got, min(n, filled));
+        for (i = 0; i < got; i++)
+            check("pop value", buf[i], popped + i);
+        break;
+    case 1:
+        for (got = 0; got < n && test_ring_pop1(&ring, &buf[got]); got++)
+            check("pop1 value", buf[got], popped + got);
+        check("pop1", got, min(n, filled));
+        break;
+    default:
+        got = n;
+        slot = test_ring_peek(&ring, &got);
+        check("peek", got, min(n, min(filled, CAPACITY - (ring.tail & (CAPACITY - 1)))));
+        for (i = 0; i < got; i++)
+            check("peek value", slot[i], popped + i);
+        test_ring_release(&ring, got);
+        break;
+    }
+    popped += got;
+}
+
+int main(void) {
+
+    uint32_t rnd = 12345;
+    unsigned i;
+
+    /* A few thousand elements before the 32-bit counters wrap */
+    test_ring_init(&ring);
+    ring.head = ring.tail = ring.tail_cache = ring.head_cache = UINT32_MAX - 4096;
+
+    for (i = 0; i < ROUNDS; i++) {
+        rnd = rnd * 1664525 + 1013904223;
+        if (rnd & 0x100)
+            push(rnd >> 28, (rnd >> 12) % 3);
+        else
+            pop(rnd >> 28, (rnd >> 12) % 3);
+    }
+    check("pushed", ring.head, UINT32_MAX - 4096 + pushed);
+    check("popped", ring.tail, UINT32_MAX - 4096 + popped);
+
+    /* Full and empty */
+    pop(2 * CAPACITY, 0);
+    push(2 * CAPACITY, 0);
+    check("full space", test_ring_space(&ring, 1), 0);
+    push(1, 1);
+    pop(2 * CAPACITY, 0);
+    check("empty count", test_ring_count(&ring, 1), 0);
+    pop(1, 1);
+
+    printf("test_ring: %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check that CLIC_STACK_WATCH attributes a stack excursion to the
+ * compiler-made handler that made it, through the CLIC_STATS_EXIT() hook,
+ * that a shallower handler running later does not take it over, and that
+ * thread code going deeper is claimed for the thread by the next
+ * handler's CLIC_STATS_ENTRY() instead of being blamed on that handler.
+ *
+ * The host build does not paint its own stack, so the test paints the
+ * part of the process stack below its sp as the hart's main stack.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_irq.h"
+#include "clic_ctx.h"
+#include "clic_stats.h"
+
+#if !CLIC_STACK_WATCH
+#error "build with -DCLIC_STACK_WATCH=1"
+#endif
+
+#define DEEP                    16
+#define SHALLOW                 17
+#define DEEP_BYTES              4096
+#define THREAD_BYTES            8192
+#define TEST_STACK              65536
+
+static void deep_handler(void);
+static void shallow_handler(void);
+
+#define TEST_IRQ_MAP(IRQ)                                                       \
+    IRQ(DEEP,    255, 255, 1, CLIC_TRIGGER_LEVEL, deep_handler)                 \
+    IRQ(SHALLOW, 255, 255, 1, CLIC_TRIGGER_LEVEL, shallow_handler)
+
+#define TEST_NAME               "test_stack"
+#include "test_hart.h"
+
+static unsigned failures;
+
+static void __attribute__((noinline)) use_stack(volatile uint8_t *buf, unsigned n) {
+
+    unsigned i;
+
+    for (i = 0; i < n; i += 4)
+        buf[i] = (uint8_t)i;
+}
+
+/* Not an interrupt, on the same stack */
+static void __attribute__((noinline)) thread_deep(void) {
+
+    volatile uint8_t buf[THREAD_BYTES];
+
+    use_stack(buf, sizeof(buf));
+}
+
+static void deep_handler(void) {
+
+    CLIC_STATS_ENTRY();
+    volatile uint8_t buf[DEEP_BYTES];
+
+    write_byte(CLICINTIP_ADDR(DEEP), DISABLE);
+    use_stack(buf, sizeof(buf));
+    CLIC_STATS_EXIT();
+}
+
+static void shallow_handler(void) {
+
+    CLIC_STATS_ENTRY();
+    write_byte(CLICINTIP_ADDR(SHALLOW), DISABLE);
+    CLIC_STATS_EXIT();
+}
+
+static void expect(const char *when, unsigned int_id, unsigned level, uintptr_t min_used) {
+
+    clic_stack_t *stack = clic_stack_get(0, CLIC_STACK_MAIN);
+    uintptr_t used = stack->base + stack->size - stack->low;
+
+    if (stack->int_id != int_id || stack->level != level || used < min_used) {
+        printf("FAIL %s: mark of %lu bytes owned by ID %u level %u, want ID %u level %u\n", when,
+               (unsigned long)used, stack->int_id, stack->level, int_id, level);
+        failures++;
+    }
+}
+
+int main(void) {
+
+    uintptr_t sp;
+
+    clic_ctx_init();
+    test_hart_init(CLIC_NLBITS);
+
+    /* Stand-in main stack: TEST_STACK bytes below here, painted below sp */
+    sp = read_sp();
+    clic_stack_paint(clic_stack_get(0, CLIC_STACK_MAIN), (sp - TEST_STACK) & ~(uintptr_t)15, TEST_STACK);
+    interrupt_global_enable();
+
+    write_byte(CLICINTIP_ADDR(DEEP), ENABLE);
+    expect("after the deep handler", DEEP, 255, DEEP_BYTES);
+
+    write_byte(CLICINTIP_ADDR(SHALLOW), ENABLE);
+    expect("after the shallow handler", DEEP, 255, DEEP_BYTES);
+
+    thread_deep();
+    write_byte(CLICINTIP_ADDR(SHALLOW), ENABLE);
+    expect("after thread code went deeper", CLIC_STACK_THREAD, 0, THREAD_BYTES);
+
+    write_byte(CLICINTIP_ADDR(DEEP), ENABLE);
+    expect("after the deep handler again", CLIC_STACK_THREAD, 0, THREAD_BYTES);
+
+    printf(TEST_NAME ": %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check of the CLIC_STATS counters: clic_stats_read() widens the
+ * 32-bit cycle sums across their wraps and clic_stats_reset() starts them
+ * over.  Built again with CLIC_HIST=1, where a level 255 line preempting a
+ * level 0 one is counted against the latter and max is kept.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_irq.h"
+#include "clic_ctx.h"
+#include "clic_stats.h"
+
+#if !CLIC_STATS
+#error "build with -DCLIC_STATS=1"
+#endif
+
+#define SLOW                    16
+#define FAST                    17
+/* mcycle a slow invocation takes, three of them wrap the 32-bit sum twice */
+#define SLOW_CYCLES             0xC0000000UL
+#define RUNS                    3
+
+static void slow_handler(void);
+static void fast_handler(void);
+
+#define TEST_IRQ_MAP(IRQ)                                                       \
+    IRQ(SLOW, 0,   0,   1, CLIC_TRIGGER_LEVEL, slow_handler)                    \
+    IRQ(FAST, 255, 255, 1, CLIC_TRIGGER_LEVEL, fast_handler)
+
+#define TEST_NAME               "test_stats"
+#include "test_hart.h"
+
+static unsigned failures;
+
+/* Preempted by FAST half way, then burns SLOW_CYCLES */
+static void slow_handler(void) {
+
+    CLIC_STATS_ENTRY();
+    write_byte(CLICINTIP_ADDR(SLOW), DISABLE);
+    write_byte(CLICINTIP_ADDR(FAST), ENABLE);
+    write_csr(mcycle, read_csr(mcycle) + SLOW_CYCLES);
+    CLIC_STATS_EXIT();
+}
+
+static void fast_handler(void) {
+
+    CLIC_STATS_ENTRY();
+    write_byte(CLICINTIP_ADDR(FAST), DISABLE);
+    CLIC_STATS_EXIT();
+}
+
+static void check(const char *what, uint64_t got, uint64_t lo, uint64_t hi) {
+
+    if (got < lo || got > hi) {
+        printf("FAIL %s: %llu, want %llu..%llu\n", what,
+               (unsigned long long)got, (unsigned long long)lo, (unsigned long long)hi);
+        failures++;
+    }
+}
+
+int main(void) {
+
+    clic_stats_sample_t sample;
+    unsigned i;
+
+    clic_ctx_init();
+    test_hart_init(CLIC_NLBITS);
+    interrupt_global_enable();
+
+    /* Read after every run, as a reader has to at least once per wrap */
+    for (i = 1; i <= RUNS; i++) {
+        write_byte(CLICINTIP_ADDR(SLOW), ENABLE);
+        clic_stats_read(SLOW, &sample);
+        check("slow count", sample.count, i, i);
+        check("slow cycles", sample.cycles, (uint64_t)i * SLOW_CYCLES, (uint64_t)i * SLOW_CYCLES + 4096 * i);
+#if CLIC_HIST
+        check("slow max", sample.max, SLOW_CYCLES, SLOW_CYCLES + 4096);
+        check("slow preempted", sample.preempted, i, i);
+#endif
+    }
+
+    clic_stats_read(FAST, &sample);
+    check("fast count", sample.count, RUNS, RUNS);
+    check("fast cycles", sample.cycles, 1, 4096 * RUNS);
+    check("fast preempted", sample.preempted, 0, 0);
+
+    interrupt_global_disable();
+    clic_stats_reset();
+    interrupt_global_enable();
+    write_byte(CLICINTIP_ADDR(SLOW), ENABLE);
+    clic_stats_read(SLOW, &sample);
+    check("count after reset", sample.count, 1, 1);
+    check("cycles after reset", sample.cycles, SLOW_CYCLES, SLOW_CYCLES + 4096);
+
+    printf(TEST_NAME ": %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
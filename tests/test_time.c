@@ -0,0 +1,155 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check of the clic_time.h conversions against a 128-bit reference,
+ * for several mtime frequencies: the edges (0, 2^32, 2^64 - 1), the
+ * inputs around the point where the result starts to saturate, and
+ * random inputs of every bit length.  clic_time_mulhi() is checked on its
+ * own as well.
+ *
+ * Built twice by make host-test, the second time with __SIZEOF_INT128__
+ * undefined so that clic_time_mulhi() takes its 32-bit digit path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CLIC_MTIME_FREQ                         32768
+#include "clic_time.h"
+
+typedef unsigned __int128 u128;
+
+static unsigned long checks, failures;
+
+/* round(x * mul / div), halves up, saturated */
+static uint64_t reference(uint64_t x, uint32_t mul, uint32_t div) {
+
+    u128 r = ((u128)x * mul + div / 2) / div;
+
+    return r > UINT64_MAX ? UINT64_MAX : (uint64_t)r;
+}
+
+static void check(const char *what, uint64_t x, uint32_t mul, uint32_t div, uint64_t got) {
+
+    uint64_t want = reference(x, mul, div);
+
+    checks++;
+    if (got == want)
+        return;
+    if (failures++ < 10)
+        printf("FAIL %s(%llu) x %lu / %lu: got %llu, want %llu\n", what, (unsigned long long)x,
+               (unsigned long)mul, (unsigned long)div, (unsigned long long)got, (unsigned long long)want);
+}
+
+static void check_scale(uint64_t x, uint32_t mul, uint32_t div) {
+
+    check("CLIC_TIME_SCALE", x, mul, div, CLIC_TIME_SCALE(x, mul, div));
+}
+
+static uint64_t rnd(void) {
+
+    static uint64_t s = 0x9E3779B97F4A7C15ULL;
+
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return s;
+}
+
+/* The multiply-high on its own, the divide's correction steps would hide
+ * an underestimate */
+static void check_mulhi(void) {
+
+    static const uint64_t edges[] = { 0, 1, 0xFFFFFFFFULL, 0x100000000ULL, UINT64_MAX };
+    uint64_t a, b;
+    unsigned i, j;
+
+    for (i = 0; i < 5; i++) {
+        for (j = 0; j < 5; j++) {
+            checks++;
+            if (clic_time_mulhi(edges[i], edges[j]) != (uint64_t)(((u128)edges[i] * edges[j]) >> 64))
+                failures++;
+        }
+    }
+    for (i = 0; i < 100000; i++) {
+        a = rnd() >> (rnd() & 63);
+        b = rnd();
+        checks++;
+        if (clic_time_mulhi(a, b) != (uint64_t)(((u128)a * b) >> 64) && failures++ < 10)
+            printf("FAIL clic_time_mulhi(%llu, %llu)\n", (unsigned long long)a, (unsigned long long)b);
+    }
+}
+
+/* Every input a pair is tried with */
+static void check_pair(uint32_t mul, uint32_t div) {
+
+    static const uint64_t edges[] = {
+        0, 1, 2, 0xFFFFFFFFULL, 0x100000000ULL, 0x100000001ULL,
+        0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, UINT64_MAX - 1, UINT64_MAX,
+    };
+    u128 limit;
+    uint64_t x;
+    unsigned i, bits;
+    int d;
+
+    for (i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+        check_scale(edges[i], mul, div);
+
+    /* Smallest x whose result saturates: x * mul + div / 2 >= 2^64 * div */
+    limit = (((u128)div << 64) - div / 2 + mul - 1) / mul;
+    if (limit <= UINT64_MAX) {
+        for (d = -2; d <= 2; d++) {
+            if ((d < 0 && limit < (u128)-d) || (d > 0 && limit + d > UINT64_MAX))
+                continue;
+            check_scale((uint64_t)(limit + d), mul, div);
+        }
+    }
+
+    /* Exact halves round up: inputs right around x * mul = k * div + div / 2 */
+    for (i = 0; i < 64; i++) {
+        x = (rnd() >> (rnd() & 63)) / mul * div;
+        check_scale(x, mul, div);
+        check_scale(x + 1, mul, div);
+    }
+
+    for (i = 0; i < 20000; i++) {
+        bits = 1 + (unsigned)(rnd() % 64);
+        x = bits == 64 ? rnd() : rnd() & ((1ULL << bits) - 1);
+        check_scale(x, mul, div);
+    }
+}
+
+int main(void) {
+
+    static const uint32_t freqs[] = { 1, 32768, 1000000, 10000000, 33333333, 4000000000U, 0xFFFFFFFFU };
+    static const uint32_t units[] = { 1000, 1000000, 1000000000 };
+    uint64_t x;
+    unsigned f, u, i;
+
+    check_mulhi();
+    for (f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++) {
+        for (u = 0; u < sizeof(units) / sizeof(units[0]); u++) {
+            check_pair(freqs[f], units[u]);     /* ms/us/ns -> ticks */
+            check_pair(units[u], freqs[f]);     /* ticks -> ms/us/ns */
+        }
+    }
+
+    /* The wrappers, at CLIC_MTIME_FREQ */
+    for (i = 0; i < 20000; i++) {
+        x = i < 2 ? (i ? UINT64_MAX : 0) : rnd() >> (rnd() & 63);
+        check("clic_ms_to_ticks", x, CLIC_MTIME_FREQ, 1000, clic_ms_to_ticks(x));
+        check("clic_us_to_ticks", x, CLIC_MTIME_FREQ, 1000000, clic_us_to_ticks(x));
+        check("clic_ns_to_ticks", x, CLIC_MTIME_FREQ, 1000000000, clic_ns_to_ticks(x));
+        check("clic_ticks_to_ms", x, 1000, CLIC_MTIME_FREQ, clic_ticks_to_ms(x));
+        check("clic_ticks_to_us", x, 1000000, CLIC_MTIME_FREQ, clic_ticks_to_us(x));
+        check("clic_ticks_to_ns", x, 1000000000, CLIC_MTIME_FREQ, clic_ticks_to_ns(x));
+    }
+
+#ifdef __SIZEOF_INT128__
+    printf("test_time (__int128 mulhi): %lu checks, %lu failed\n", checks, failures);
+#else
+    printf("test_time (32-bit mulhi): %lu checks, %lu failed\n", checks, failures);
+#endif
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host check of the software timer wheel: timers on every level and on the
+ * overflow list expire exactly once, never before their deadline and at
+ * the first clic_timer_process() at or after it, however often they
+ * cascade on the way.  A callback may cancel timers due in the same pass,
+ * in its own slot or a later one, and restart itself.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clic_hal.h"
+#include "clic_ctx.h"
+#include "clic_timer.h"
+#include "clic_model.h"
+
+#define TIMERS                  256
+/* Past the 2^24 ticks the levels cover, so the overflow list is used */
+#define SPAN                    (1ULL << 26)
+
+/* Deadlines on the level and overflow boundaries, the rest are random */
+static const uint64_t edges[] = {
+    0, 1, 63, 64, 65, 4095, 4096, 4097, (1 << 18) - 1, 1 << 18,
+    (1 << 24) - 1, 1 << 24, (1 << 24) + 1, SPAN - 1, SPAN,
+};
+
+static clic_timer_t timers[TIMERS];
+static unsigned fired[TIMERS];
+static unsigned failures;
+
+static void expired(clic_timer_t *timer) {
+
+    fired[timer - timers]++;
+}
+
+/* Move mtime to 'at', expire what is due there and check every timer */
+static uint64_t step(uint64_t at) {
+
+    uint64_t next;
+    unsigned i;
+
+    clic_model_advance_mtime(at - clic_timer_now());
+    next = clic_timer_process(at);
+    for (i = 0; i < TIMERS; i++) {
+        if (fired[i] != (timers[i].expires <= at) || clic_timer_pending(&timers[i]) == (timers[i].expires <= at)) {
+            printf("FAIL timer %u due at %llu: fired %u times by %llu\n", i,
+                   (unsigned long long)timers[i].expires, fired[i], (unsigned long long)at);
+            failures++;
+            fired[i] = timers[i].expires <= at;
+        }
+    }
+    return next;
+}
+
+static void cascade(void) {
+
+    uint64_t base, now, next;
+    uint32_t rnd = 12345, gap;
+    unsigned i;
+
+    base = clic_timer_now();
+    for (i = 0; i < TIMERS; i++) {
+        rnd = rnd * 1664525 + 1013904223;
+        timers[i] = (clic_timer_t)CLIC_TIMER_INIT(expired);
+        clic_timer_start(&timers[i], base + (i < sizeof(edges) / sizeof(edges[0]) ? edges[i] : rnd % SPAN));
+    }
+
+    /* Mostly on the slot the wheel asks for or the earliest deadline, so
+     * a timer one tick early or late shows, sometimes late past both */
+    now = base;
+    next = step(now);
+    while (next != UINT64_MAX) {
+        rnd = rnd * 1664525 + 1013904223;
+        gap = 1 + (rnd >> 13);
+        if (rnd & 3) {
+            now = next;
+            for (i = 0; i < TIMERS; i++)
+                if (!fired[i] && timers[i].expires < now)
+                    now = timers[i].expires;
+        } else {
+            now += gap;
+        }
+        next = step(now);
+    }
+    for (i = 0; i < TIMERS; i++)
+        if (fired[i] != 1) {
+            printf("FAIL timer %u fired %u times\n", i, fired[i]);
+            failures++;
+        }
+}
+
+static clic_timer_t killer, victim[3];
+static unsigned killer_runs, victim_runs[3];
+static int cancelled[3];
+
+static void victim_expired(clic_timer_t *timer) {
+
+    victim_runs[timer - victim]++;
+}
+
+/* Cancels every victim on its first run and restarts itself once */
+static void killer_expired(clic_timer_t *timer) {
+
+    unsigned i;
+
+    if (killer_runs++)
+        return;
+    for (i = 0; i < 3; i++)
+        cancelled[i] = clic_timer_cancel(&victim[i]);
+    clic_timer_start(timer, timer->expires + 100);
+}
+
+static void cancel_from_callback(void) {
+
+    uint64_t base = clic_timer_now();
+    unsigned i;
+
+    /* victim 0 and 1 share the killer's slot, on either side of it in the
+     * slot's list; victim 2 is due later in the same pass */
+    for (i = 0; i < 3; i++)
+        victim[i] = (clic_timer_t)CLIC_TIMER_INIT(victim_expired);
+    killer = (clic_timer_t)CLIC_TIMER_INIT(killer_expired);
+    clic_timer_start(&victim[0], base + 5000);
+    clic_timer_start(&killer, base + 5000);
+    clic_timer_start(&victim[1], base + 5000);
+    clic_timer_start(&victim[2], base + 5010);
+
+    clic_model_advance_mtime(base + 5050 - clic_timer_now());
+    clic_timer_process(clic_timer_now());
+    for (i = 0; i < 3; i++) {
+        if (victim_runs[i] + cancelled[i] != 1 || clic_timer_pending(&victim[i])) {
+            printf("FAIL victim %u: ran %u times, cancel returned %d\n", i, victim_runs[i], cancelled[i]);
+            failures++;
+        }
+    }
+    if (victim_runs[2] != 0) {
+        printf("FAIL victim 2 ran after its cancel\n");
+        failures++;
+    }
+
+    clic_model_advance_mtime(base + 5100 - clic_timer_now());
+    if (clic_timer_process(clic_timer_now()) != UINT64_MAX || killer_runs != 2) {
+        printf("FAIL restarted killer: %u runs\n", killer_runs);
+        failures++;
+    }
+}
+
+int main(void) {
+
+    clic_ctx_init();
+    clic_timer_init();
+
+    cascade();
+    cancel_from_callback();
+
+    printf("test_wheel: %u failed\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
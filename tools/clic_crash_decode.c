@@ -0,0 +1,172 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host decoder for the crash log of clic_crash.h.
+ *
+ *   clic_crash_decode [file]
+ *
+ * Reads the "clic_crash <hex>" lines clic_crash_dump() prints (any other
+ * console output around them is skipped), or a raw memory dump of
+ * clic_crash_log, e.g. from gdb:
+ *
+ *   dump binary value crash.bin clic_crash_log
+ *
+ * and prints one report per fault, oldest first per hart.  Addresses can
+ * be fed to addr2line -e <program> for source lines.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIC_CRASH_MAGIC        0xC1C0FA17UL
+#define HEADER_SIZE             16
+
+static const char * const exception_names[16] = {
+    "instruction address misaligned", "instruction access fault", "illegal instruction",
+    "breakpoint", "load address misaligned", "load access fault",
+    "store/AMO address misaligned", "store/AMO access fault", "ecall from U-mode",
+    "ecall from S-mode", "reserved", "ecall from M-mode",
+    "instruction page fault", "load page fault", "reserved", "store/AMO page fault",
+};
+
+static uint64_t get(const uint8_t *p, unsigned size) {
+
+    uint64_t v = 0;
+
+    while (size--)
+        v = (v << 8) | p[size];
+    return v;
+}
+
+/* Size of the log at p, the same for every hart, or 0 if there is none */
+static size_t log_size(const uint8_t *p, size_t len) {
+
+    unsigned xlen, depth, rec_size;
+    size_t size;
+
+    if (len < HEADER_SIZE || get(p, 4) != CLIC_CRASH_MAGIC)
+        return 0;
+    xlen = p[8];
+    depth = p[9];
+    rec_size = (unsigned)get(p + 10, 2);
+    size = HEADER_SIZE + (size_t)depth * rec_size;
+    if ((xlen != 32 && xlen != 64) || !depth || rec_size < 5 * (xlen / 8) + 12 || len < size)
+        return 0;
+    return size;
+}
+
+/* One hart's log, returns 0 if it is not one */
+static size_t decode_log(const uint8_t *p, size_t len) {
+
+    unsigned xlen, depth, rec_size, w, n, i;
+    uint32_t head, first;
+    const uint8_t *r;
+    uint64_t mcause, code;
+    size_t size;
+
+    if (len < HEADER_SIZE || get(p, 4) != CLIC_CRASH_MAGIC)
+        return 0;
+    if (!(size = log_size(p, len))) {
+        fprintf(stderr, "clic_crash_decode: bad log header\n");
+        return 0;
+    }
+    head = (uint32_t)get(p + 4, 4);
+    xlen = p[8];
+    depth = p[9];
+    rec_size = (unsigned)get(p + 10, 2);
+    w = xlen / 8;
+
+    n = head < depth ? head : depth;
+    first = head - n;
+    for (i = 0; i < n; i++) {
+        r = p + HEADER_SIZE + (size_t)((first + i) % depth) * rec_size;
+        mcause = get(r, w);
+        code = mcause & 0x3FF;
+
+        printf("fault #%u on hart %u at mcycle %u, level %u\n",
+               (unsigned)get(r + 5 * w + 4, 4), r[5 * w + 8],
+               (unsigned)get(r + 5 * w, 4), r[5 * w + 9]);
+        if (mcause >> (xlen - 1))
+            printf("  mcause 0x%0*llx  interrupt %u with no handler\n", (int)w * 2,
+                   (unsigned long long)mcause, (unsigned)code);
+        else
+            printf("  mcause 0x%0*llx  %s\n", (int)w * 2, (unsigned long long)mcause,
+                   code < 16 ? exception_names[code] : "custom exception");
+        printf("  mpil %u, mpie %u\n", (unsigned)((mcause >> 16) & 0xFF), (unsigned)((mcause >> 27) & 1));
+        printf("  mepc  0x%0*llx\n", (int)w * 2, (unsigned long long)get(r + w, w));
+        printf("  mtval 0x%0*llx\n", (int)w * 2, (unsigned long long)get(r + 2 * w, w));
+        printf("  sp    0x%0*llx\n", (int)w * 2, (unsigned long long)get(r + 3 * w, w));
+        printf("  ra    0x%0*llx\n", (int)w * 2, (unsigned long long)get(r + 4 * w, w));
+    }
+    if (head > depth)
+        printf("(%u older faults overwritten)\n", (unsigned)(head - depth));
+    return size;
+}
+
+static int hexval(int c) {
+
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+int main(int argc, char **argv) {
+
+    FILE *f = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    uint8_t *buf = NULL, *bin;
+    size_t len = 0, cap = 0, got, off, size = 0, n;
+    const char *line, *end, *hex;
+    unsigned logs = 0;
+
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    do {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 4096;
+            buf = realloc(buf, cap + 1);
+            if (!buf)
+                return 1;
+        }
+        got = fread(buf + len, 1, cap - len, f);
+        len += got;
+    } while (got);
+    buf[len] = 0;
+
+    /* A raw dump has the binary magic somewhere, the text lines never do */
+    for (off = 0; off < len && !(size = log_size(buf + off, len - off)); off += 8);
+
+    if (off < len) {
+        /* The logs of all harts back to back, one fixed size each.  A hart
+         * that never faulted has no magic and is skipped. */
+        for (off %= size; off + size <= len; off += size)
+            if (decode_log(buf + off, len - off))
+                logs++;
+    } else {
+        bin = malloc(len / 2 + 1);
+        for (line = (const char *)buf; bin && line && *line; line = end ? end + 1 : NULL) {
+            end = strchr(line, '\n');
+            if (!(hex = strstr(line, "clic_crash ")) || (end && hex > end))
+                continue;
+            hex += strlen("clic_crash ");
+            for (n = 0; hexval(hex[0]) >= 0 && hexval(hex[1]) >= 0; hex += 2)
+                bin[n++] = (uint8_t)(hexval(hex[0]) << 4 | hexval(hex[1]));
+            if (decode_log(bin, n))
+                logs++;
+        }
+        free(bin);
+    }
+
+    if (!logs)
+        printf("no crash log found\n");
+    free(buf);
+    return logs ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host symbolizer for the sampling profiler of clic_prof.h.
+ *
+ *   clic_prof_symbolize [-f] program.elf prof.bin
+ *
+ * Maps every sampled pc (and ra) to the function of the ELF's symbol table
+ * that contains it and prints a flat profile, hottest function first.  With
+ * -f it prints folded stacks instead, "caller;function count" per line with
+ * the caller taken from ra, for flamegraph.pl or speedscope.
+ *
+ * Reads 32 and 64-bit little endian ELF files directly, so no RISC-V
+ * binutils are needed on the host.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIC_PROF_MAGIC         0xC1C0960FUL
+#define HEADER_SIZE             24
+
+#define SHT_SYMTAB              2
+#define STT_FUNC                2
+
+struct sym {
+    uint64_t addr;
+    uint64_t size;
+    const char *name;
+};
+
+struct count {
+    char *key;
+    unsigned n;
+};
+
+static struct sym *syms;
+static unsigned nsyms;
+static struct count *counts;
+static unsigned ncounts, capcounts;
+
+static uint64_t get(const uint8_t *p, unsigned size) {
+
+    uint64_t v = 0;
+
+    while (size--)
+        v = (v << 8) | p[size];
+    return v;
+}
+
+static uint8_t *load(const char *path, size_t *len) {
+
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long n;
+
+    if (!f || fseek(f, 0, SEEK_END) || (n = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)) {
+        perror(path);
+        exit(1);
+    }
+    buf = malloc((size_t)n + 1);
+    if (!buf || fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+    *len = (size_t)n;
+    return buf;
+}
+
+static int cmp_sym(const void *a, const void *b) {
+
+    const struct sym *x = a, *y = b;
+
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+/* Function symbols of the ELF's .symtab, sorted by address */
+static void read_symbols(const uint8_t *elf, size_t len) {
+
+    int is64 = elf[4] == 2;
+    uint64_t shoff, off, size, entsize, i, s;
+    unsigned shentsize, shnum, link, type;
+    const uint8_t *sh, *st, *strtab;
+
+    if (len < 64 || memcmp(elf, "\177ELF", 4) || elf[5] != 1) {
+        fprintf(stderr, "clic_prof_symbolize: not a little endian ELF file\n");
+        exit(1);
+    }
+    shoff = is64 ? get(elf + 0x28, 8) : get(elf + 0x20, 4);
+    shentsize = (unsigned)get(elf + (is64 ? 0x3A : 0x2E), 2);
+    shnum = (unsigned)get(elf + (is64 ? 0x3C : 0x30), 2);
+
+    for (s = 0; s < shnum; s++) {
+        sh = elf + shoff + s * shentsize;
+        if (get(sh + 4, 4) != SHT_SYMTAB)
+            continue;
+        off = get(sh + (is64 ? 0x18 : 0x10), is64 ? 8 : 4);
+        size = get(sh + (is64 ? 0x20 : 0x14), is64 ? 8 : 4);
+        link = (unsigned)get(sh + (is64 ? 0x28 : 0x18), 4);
+        entsize = get(sh + (is64 ? 0x38 : 0x24), is64 ? 8 : 4);
+        strtab = elf + get(elf + shoff + link * shentsize + (is64 ? 0x18 : 0x10), is64 ? 8 : 4);
+
+        syms = calloc(size / entsize, sizeof(*syms));
+        for (i = 0; i < size / entsize; i++) {
+            st = elf + off + i * entsize;
+            type = (is64 ? st[4] : st[12]) & 0xF;
+            /* Imports are STT_FUNC too, but undefined (st_shndx 0) */
+            if (type != STT_FUNC || !get(st + (is64 ? 6 : 14), 2))
+                continue;
+            syms[nsyms].name = (const char *)strtab + get(st, 4);
+            syms[nsyms].addr = is64 ? get(st + 8, 8) : get(st + 4, 4);
+            syms[nsyms].size = is64 ? get(st + 16, 8) : get(st + 8, 4);
+            nsyms++;
+        }
+        qsort(syms, nsyms, sizeof(*syms), cmp_sym);
+        return;
+    }
+    fprintf(stderr, "clic_prof_symbolize: no symbol table, was the ELF stripped?\n");
+    exit(1);
+}
+
+/* Function containing addr, NULL if none */
+static const char *lookup(uint64_t addr) {
+
+    unsigned lo = 0, hi = nsyms, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (syms[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (!lo || (syms[lo - 1].size && addr >= syms[lo - 1].addr + syms[lo - 1].size))
+        return NULL;
+    return syms[lo - 1].name;
+}
+
+static void add(const char *key) {
+
+    unsigned i;
+
+    for (i = 0; i < ncounts; i++) {
+        if (!strcmp(counts[i].key, key)) {
+            counts[i].n++;
+            return;
+        }
+    }
+    if (ncounts == capcounts) {
+        capcounts = capcounts ? capcounts * 2 : 64;
+        counts = realloc(counts, capcounts * sizeof(*counts));
+    }
+    counts[ncounts].key = strdup(key);
+    counts[ncounts++].n = 1;
+}
+
+static int cmp_count(const void *a, const void *b) {
+
+    const struct count *x = a, *y = b;
+
+    return (y->n > x->n) - (y->n < x->n);
+}
+
+int main(int argc, char **argv) {
+
+    uint8_t *elf, *prof;
+    size_t elf_len, prof_len;
+    unsigned count, xlen, w, hz, i;
+    int folded = 0, arg = 1;
+    const char *fn, *caller;
+    char pcbuf[32], key[512];
+    uint64_t pc, ra;
+
+    if (arg < argc && !strcmp(argv[arg], "-f")) {
+        folded = 1;
+        arg++;
+    }
+    if (argc - arg != 2) {
+        fprintf(stderr, "usage: clic_prof_symbolize [-f] program.elf prof.bin\n");
+        return 1;
+    }
+    elf = load(argv[arg], &elf_len);
+    prof = load(argv[arg + 1], &prof_len);
+    read_symbols(elf, elf_len);
+
+    if (prof_len < HEADER_SIZE || get(prof, 4) != CLIC_PROF_MAGIC) {
+        fprintf(stderr, "clic_prof_symbolize: no profile in %s\n", argv[arg + 1]);
+        return 1;
+    }
+    count = (unsigned)get(prof + 4, 4);
+    hz = (unsigned)get(prof + 12, 4);
+    xlen = (unsigned)get(prof + 16, 4);
+    w = xlen / 8;
+    if ((xlen != 32 && xlen != 64) || prof_len < HEADER_SIZE + (size_t)count * 2 * w) {
+        fprintf(stderr, "clic_prof_symbolize: bad profile header\n");
+        return 1;
+    }
+
+    for (i = 0; i < count; i++) {
+        pc = get(prof + HEADER_SIZE + (size_t)i * 2 * w, w);
+        ra = get(prof + HEADER_SIZE + (size_t)i * 2 * w + w, w);
+        if (!(fn = lookup(pc))) {
+            snprintf(pcbuf, sizeof(pcbuf), "0x%llx", (unsigned long long)pc);
+            fn = pcbuf;
+        }
+        if (!folded) {
+            add(fn);
+            continue;
+        }
+        /* ra inside the same function is not a caller */
+        caller = lookup(ra);
+        if (caller && strcmp(caller, fn))
+            snprintf(key, sizeof(key), "%s;%s", caller, fn);
+        else
+            snprintf(key, sizeof(key), "%s", fn);
+        add(key);
+    }
+
+    qsort(counts, ncounts, sizeof(*counts), cmp_count);
+    if (!folded)
+        printf("%u samples at %u Hz\n%8s %7s  %s\n", count, hz, "samples", "%", "function");
+    for (i = 0; i < ncounts; i++) {
+        if (folded)
+            printf("%s %u\n", counts[i].key, counts[i].n);
+        else
+            printf("%8u %6.2f%%  %s\n", counts[i].n, 100.0 * counts[i].n / count, counts[i].key);
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+/* Copyright 2019 SiFive, Inc */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Host decoder for the interrupt trace of clic_trace.h.
+ *
+ *   clic_trace_decode [-f hz] [file] > trace.json
+ *
+ * Reads a memory dump of clic_trace (one buffer per hart, back to back) and
+ * writes Chrome trace JSON for chrome://tracing or ui.perfetto.dev: one
+ * process per hart, interrupt handlers as nested slices named by ID and
+ * level, pends and exceptions as instant events.  Timestamps are in
+ * microseconds with -f (the mcycle frequency), in cycles otherwise.
+ *
+ * Records only hold deltas; each hart's timeline is placed by the mcycle of
+ * its newest record from the buffer header, so harts line up as far as
+ * their mcycle counters do.  Time 0 is the oldest record of any hart.
+ *
+ * A summary on stderr gives the deepest nesting seen and the longest
+ * handler slice, the two things to look at first.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIC_TRACE_MAGIC        0xC1C07ACEUL
+#define HEADER_SIZE             32
+#define REC_SIZE                8
+
+#define CLIC_TRACE_ENTER        1
+#define CLIC_TRACE_EXIT         2
+#define CLIC_TRACE_PEND         3
+#define CLIC_TRACE_EXCEPTION    4
+
+#define MAX_NEST                256
+
+static double hz;
+static int first_event = 1;
+static unsigned max_nest;
+static uint64_t longest, longest_at;
+static unsigned longest_id, longest_hart;
+
+static uint32_t get32(const uint8_t *p) {
+
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void event(const char *name, unsigned id, unsigned level, const char *ph, unsigned hart, uint64_t t) {
+
+    printf("%s\n  {\"name\": \"%s %u\", \"ph\": \"%s\", \"pid\": %u, \"tid\": 0, \"ts\": %.3f%s, "
+           "\"args\": {\"level\": %u}}",
+           first_event ? "" : ",", name, id, ph, hart, hz ? t * 1e6 / hz : (double)t,
+           ph[0] == 'i' ? ", \"s\": \"t\"" : "", level);
+    first_event = 0;
+}
+
+/* Size of the buffer at p, the same for every hart, or 0 if there is none */
+static size_t buffer_size(const uint8_t *p, size_t len) {
+
+    uint32_t depth;
+    size_t size;
+
+    if (len < HEADER_SIZE || get32(p) != CLIC_TRACE_MAGIC)
+        return 0;
+    depth = get32(p + 12);
+    size = HEADER_SIZE + (size_t)depth * REC_SIZE;
+    if (!depth || (depth & (depth - 1)) || len < size)
+        return 0;
+    return size;
+}
+
+/* Records of a buffer that survived, and the first of them */
+static uint32_t surviving(const uint8_t *p, uint32_t *first) {
+
+    uint32_t head = get32(p + 8), depth = get32(p + 12);
+    uint32_t n = head < depth ? head : depth;
+
+    *first = head - n;
+    return n;
+}
+
+/* mcycle (low word) of the oldest surviving record, from the newest one's */
+static uint32_t oldest_mcycle(const uint8_t *p) {
+
+    uint32_t depth = get32(p + 12), t = get32(p + 16), n, first, i;
+
+    n = surviving(p, &first);
+    for (i = 1; i < n; i++)
+        t -= get32(p + HEADER_SIZE + (size_t)((first + i) & (depth - 1)) * REC_SIZE);
+    return t;
+}
+
+/* One hart's buffer, its oldest record at t0, returns 0 if it is not one */
+static size_t decode(const uint8_t *p, size_t len, uint64_t t0) {
+
+    uint32_t head, depth, last, dropped, hart, n, first, i;
+    uint64_t t, start[MAX_NEST];
+    unsigned nest = 0, type, level, id, ids[MAX_NEST];
+    const uint8_t *r;
+    size_t size;
+
+    if (len < HEADER_SIZE || get32(p) != CLIC_TRACE_MAGIC)
+        return 0;
+    if (!(size = buffer_size(p, len))) {
+        fprintf(stderr, "clic_trace_decode: bad trace header\n");
+        return 0;
+    }
+    head = get32(p + 8);
+    depth = get32(p + 12);
+    last = get32(p + 16);
+    dropped = get32(p + 20);
+    hart = get32(p + 24);
+
+    printf("%s\n  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %u, \"args\": {\"name\": \"hart %u\"}}",
+           first_event ? "" : ",", hart, hart);
+    first_event = 0;
+
+    /* Oldest surviving record first, its delta points at one overwritten */
+    n = surviving(p, &first);
+    t = t0;
+    for (i = 0; i < n; i++) {
+        r = p + HEADER_SIZE + (size_t)((first + i) & (depth - 1)) * REC_SIZE;
+        if (i)
+            t += get32(r);
+        type = r[4];
+        level = r[5];
+        id = (unsigned)r[6] | (unsigned)r[7] << 8;
+
+        switch (type) {
+        case CLIC_TRACE_ENTER:
+            if (nest < MAX_NEST) {
+                start[nest] = t;
+                ids[nest] = id;
+            }
+            nest++;
+            if (nest > max_nest)
+                max_nest = nest;
+            event("irq", id, level, "B", hart, t);
+            break;
+        case CLIC_TRACE_EXIT:
+            /* Exits of handlers entered before the oldest record */
+            if (!nest)
+                break;
+            nest--;
+            if (nest < MAX_NEST && ids[nest] == id && t - start[nest] > longest) {
+                longest = t - start[nest];
+                longest_at = start[nest];
+                longest_id = id;
+                longest_hart = hart;
+            }
+            event("irq", id, level, "E", hart, t);
+            break;
+        case CLIC_TRACE_PEND:
+            event("pend", id, level, "i", hart, t);
+            break;
+        case CLIC_TRACE_EXCEPTION:
+            event("exception", id, level, "i", hart, t);
+            break;
+        }
+    }
+
+    fprintf(stderr, "hart %u: %u records", hart, n);
+    if (head > depth)
+        fprintf(stderr, ", %u older overwritten", head - depth);
+    if (dropped)
+        fprintf(stderr, ", %u dropped when full", dropped);
+    fprintf(stderr, ", last at mcycle %u\n", last);
+    return size;
+}
+
+int main(int argc, char **argv) {
+
+    uint8_t *buf = NULL;
+    size_t len = 0, cap = 0, got, off, size = 0;
+    unsigned harts = 0;
+    uint32_t ref = 0;
+    int32_t earliest = 0, rel;
+    FILE *f = stdin;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            hz = atof(argv[++i]);
+        } else if (!(f = fopen(argv[i], "rb"))) {
+            perror(argv[i]);
+            return 1;
+        }
+    }
+
+    do {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 65536;
+            buf = realloc(buf, cap);
+            if (!buf)
+                return 1;
+        }
+        got = fread(buf + len, 1, cap - len, f);
+        len += got;
+    } while (got);
+
+    /* Buffers of one size back to back, a hart that never called
+     * clic_trace_start() has no magic and is skipped */
+    for (off = 0; off < len && !(size = buffer_size(buf + off, len - off)); off += 4);
+    if (off < len) {
+        /* Oldest record of all harts, as an offset within the 32-bit wrap */
+        ref = oldest_mcycle(buf + off);
+        for (off %= size; off + size <= len; off += size) {
+            if (buffer_size(buf + off, len - off)) {
+                rel = (int32_t)(oldest_mcycle(buf + off) - ref);
+                if (rel < earliest)
+                    earliest = rel;
+            }
+        }
+    }
+
+    printf("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    if (size) {
+        for (off %= size; off + size <= len; off += size) {
+            rel = buffer_size(buf + off, len - off) ? (int32_t)(oldest_mcycle(buf + off) - ref) : earliest;
+            if (decode(buf + off, len - off, (uint64_t)((int64_t)rel - earliest)))
+                harts++;
+        }
+    }
+    printf("\n]}\n");
+
+    if (!harts) {
+        fprintf(stderr, "clic_trace_decode: no trace found\n");
+        return 1;
+    }
+    fprintf(stderr, "deepest nesting %u", max_nest);
+    if (longest)
+        fprintf(stderr, ", longest handler: irq %u on hart %u, %llu cycles from %llu",
+                longest_id, longest_hart, (unsigned long long)longest, (unsigned long long)longest_at);
+    fprintf(stderr, "\n");
+    free(buf);
+    return 0;
+}